@@ -560,5 +560,10 @@ void SNES_SPC::end_frame( time_t end_time )
 		save_extra();
 }
 
+#ifdef DEBUGGER
+#include "gilgamesh.h"
+#define SPC_CPU_OPCODE_HOOK( addr, opcode ) if ( GilgameshTracing ) GilgameshTraceSPC700( ram, addr, dp, x, y )
+#endif
+
 // Inclusion here allows static memory access functions and better optimization
 #include "SPC_CPU.h"
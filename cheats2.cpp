@@ -191,6 +191,7 @@ static uint8 S9xGetByteFree (uint32 address)
 
 	byte = S9xGetByte(address);
 	CPU.Cycles = Cycles;
+	CPU.NextCheck = 0;
 
 	return (byte);
 }
@@ -201,6 +202,7 @@ static void S9xSetByteFree (uint8 byte, uint32 address)
 
 	S9xSetByte(byte, address);
 	CPU.Cycles = Cycles;
+	CPU.NextCheck = 0;
 }
 
 void S9xInitWatchedAddress (void)
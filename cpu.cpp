@@ -223,6 +223,7 @@ static void S9xSoftResetCPU (void)
 	CPU.MemSpeed = SLOW_ONE_CYCLE;
 	CPU.MemSpeedx2 = SLOW_ONE_CYCLE * 2;
 	CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+	Memory.map_Speed();
 	CPU.InDMA = FALSE;
 	CPU.InHDMA = FALSE;
 	CPU.InDMAorHDMA = FALSE;
@@ -231,6 +232,7 @@ static void S9xSoftResetCPU (void)
 	CPU.CurrentDMAorHDMAChannel = -1;
 	CPU.WhichEvent = HC_RENDER_EVENT;
 	CPU.NextEvent  = Timings.RenderPos;
+	CPU.NextCheck = 0;
 	CPU.WaitingForInterrupt = FALSE;
 	CPU.AutoSaveTimer = 0;
 	CPU.SRAMModified = FALSE;
@@ -268,7 +270,7 @@ static void S9xSoftResetCPU (void)
 	S9xUnpackStatus();
 
 #ifdef DEBUGGER
-	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_RESET);
+	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_RESET, PROCESSOR_CPU);
 #endif
 }
 
@@ -191,9 +191,368 @@
 
 static inline void S9xReschedule (void);
 
+// What S9xMainLoop checks before every instruction, besides emulation.
+enum
+{
+	MAIN_LOOP_BREAK     = 1 << 0,	// breakpoints, watchpoints and single-stepping
+	MAIN_LOOP_TRACE     = 1 << 1,	// trace.log
+	MAIN_LOOP_GILGAMESH = 1 << 2,	// Gilgamesh trace and cycle profile
+	MAIN_LOOP_IDLE      = 1 << 3	// idle loop skipping (Settings.SkipIdleLoops)
+};
+
+// Idle loops: a short run of instructions that only read memory and
+// registers, ending with a branch back to its start (or a WAI). Once a pass
+// leaves the CPU exactly as the previous one did, with no event or interrupt
+// in between, every following pass does the same until something outside
+// the loop changes. Those passes are skipped by adding their cycles at once,
+// up to the first cycle anything could change.
+enum
+{
+	IDLE_NO = 0,
+	IDLE_IMPLIED,
+	IDLE_IMMEDIATE,
+	IDLE_DIRECT,
+	IDLE_ABSOLUTE,
+	IDLE_LONG,
+	IDLE_BRANCH,
+	IDLE_INDEX = 0x10	// reads as wide as X and Y, not A
+};
+
+static uint8	IdleOps[256];
+
+static struct
+{
+	uint32				Head;			// PBPC of the loop, or ~0
+	uint32				Branch;			// PBPC of its last instruction
+	uint32				Rejected;		// last start found not to be an idle loop
+	bool8				Armed;			// the state below was taken at Head
+	uint32				Generation;
+	int32				Cycles;
+	int32				PrevCycles;
+	struct SRegisters	Registers;
+	uint8				Flags[4];		// ICPU._Carry, _Zero, _Negative, _Overflow
+	uint8				OpenBus;
+	bool8				ReadsHVBJOY;	// $4212 changes with the H counter
+	bool8				ReadsRDNMI;		// $4210 changes once read
+	uint32				Instructions;	// per pass, for the SA-1 to follow
+}	IdleLoop = { ~0U, ~0U, ~0U, FALSE, 0, 0, 0, {}, {}, 0, FALSE, FALSE, 0 };
+
+static uint32	IdleGeneration;			// events and interrupts so far
+
+static void S9xInitIdleOps (void)
+{
+	static const uint8	direct[]    = { 0x05, 0x25, 0x45, 0x65, 0xc5, 0xe5, 0xa5, 0x24 };
+	static const uint8	absolute[]  = { 0x0d, 0x2d, 0x4d, 0x6d, 0xcd, 0xed, 0xad, 0x2c };
+	static const uint8	longs[]     = { 0x0f, 0x2f, 0x4f, 0x6f, 0xcf, 0xef, 0xaf };
+	static const uint8	immediate[] = { 0x09, 0x29, 0x49, 0x69, 0xc9, 0xe9, 0xa9, 0x89 };
+	static const uint8	implied[]   = { 0xaa, 0xa8, 0x8a, 0x98, 0x9b, 0xbb, 0xe8, 0xc8, 0xca, 0x88, 0x1a, 0x3a,
+										0x0a, 0x4a, 0x2a, 0x6a, 0x18, 0x38, 0xb8, 0xea, 0xeb, 0x7b, 0x3b };
+	static const uint8	branch[]    = { 0x10, 0x30, 0x50, 0x70, 0x90, 0xb0, 0xd0, 0xf0, 0x80 };
+
+	for (unsigned i = 0; i < sizeof(direct); i++)
+		IdleOps[direct[i]] = IDLE_DIRECT;
+	for (unsigned i = 0; i < sizeof(absolute); i++)
+		IdleOps[absolute[i]] = IDLE_ABSOLUTE;
+	for (unsigned i = 0; i < sizeof(longs); i++)
+		IdleOps[longs[i]] = IDLE_LONG;
+	for (unsigned i = 0; i < sizeof(immediate); i++)
+		IdleOps[immediate[i]] = IDLE_IMMEDIATE;
+	for (unsigned i = 0; i < sizeof(implied); i++)
+		IdleOps[implied[i]] = IDLE_IMPLIED;
+	for (unsigned i = 0; i < sizeof(branch); i++)
+		IdleOps[branch[i]] = IDLE_BRANCH;
+
+	// LDX, LDY, CPX, CPY
+	IdleOps[0xa2] = IdleOps[0xa0] = IdleOps[0xe0] = IdleOps[0xc0] = IDLE_IMMEDIATE | IDLE_INDEX;
+	IdleOps[0xa6] = IdleOps[0xa4] = IdleOps[0xe4] = IdleOps[0xc4] = IDLE_DIRECT | IDLE_INDEX;
+	IdleOps[0xae] = IdleOps[0xac] = IdleOps[0xec] = IdleOps[0xcc] = IDLE_ABSOLUTE | IDLE_INDEX;
+}
 
-void S9xMainLoop (void)
+// Whether reading Address can't have side effects, nor give another value
+// before the next event (besides $4210 and $4212, which are dealt with apart).
+static bool8 S9xIdleReadable (uint32 Address)
+{
+	uint8	*block = Memory.Map[(Address & 0xffffff) >> MEMMAP_SHIFT];
+
+	if (block >= (uint8 *) CMemory::MAP_LAST)
+		return (TRUE);
+
+	if (block != (uint8 *) CMemory::MAP_CPU)
+		return (FALSE);
+
+	switch (Address & 0xffff)
+	{
+		case 0x4210:
+			IdleLoop.ReadsRDNMI = TRUE;
+			return (TRUE);
+
+		case 0x4212:
+			IdleLoop.ReadsHVBJOY = TRUE;
+			return (TRUE);
+
+		default:
+			// multiplication, division and auto-joypad results
+			return ((Address & 0xffff) >= 0x4214 && (Address & 0xffff) <= 0x421f);
+	}
+}
+
+// Whether the code from Head to Branch is an idle loop, with the registers
+// and memory map as they are now.
+static bool8 S9xIdleLoopValid (uint32 Branch, uint32 Head)
+{
+	IdleLoop.ReadsHVBJOY = FALSE;
+	IdleLoop.ReadsRDNMI = FALSE;
+
+	uint8	*code = Memory.Map[Head >> MEMMAP_SHIFT];
+	if (code < (uint8 *) CMemory::MAP_LAST || Branch - Head > 16 || ((Branch + 1) ^ Head) & ~MEMMAP_MASK)
+		return (FALSE);
+	code += Head & 0xffff;
+
+	IdleLoop.Instructions = 1;
+
+	if (Branch == Head)
+		return (code[0] == 0xcb);	// WAI
+
+	for (uint32 pc = Head; pc != Branch; IdleLoop.Instructions++)
+	{
+		uint8	*bytes = code + (pc - Head);
+		uint8	kind = IdleOps[bytes[0]];
+		uint8	length = ICPU.S9xOpLengths[bytes[0]];
+		bool8	wide = (kind & IDLE_INDEX) ? !CheckIndex() : !CheckMemory();
+		uint32	address = ~0U;
+
+		if (pc + length > Branch)
+			return (FALSE);
+
+		switch (kind & ~IDLE_INDEX)
+		{
+			case IDLE_IMPLIED:
+			case IDLE_IMMEDIATE:
+				break;
+
+			case IDLE_DIRECT:
+				address = (Registers.D.W + bytes[1]) & 0xffff;
+				break;
+
+			case IDLE_ABSOLUTE:
+				address = (Registers.DB << 16) | (bytes[2] << 8) | bytes[1];
+				break;
+
+			case IDLE_LONG:
+				address = (bytes[3] << 16) | (bytes[2] << 8) | bytes[1];
+				break;
+
+			default:
+				return (FALSE);
+		}
+
+		if (address != ~0U && (!S9xIdleReadable(address) || (wide && !S9xIdleReadable(address + 1))))
+			return (FALSE);
+
+		pc += length;
+	}
+
+	return (IdleOps[code[Branch - Head]] == IDLE_BRANCH);
+}
+
+// Called after a branch from Branch back to Head (or a WAI, where both are the same).
+static void S9xIdleLoopCandidate (uint32 Branch, uint32 Head)
+{
+	if (Head == IdleLoop.Head || Head == IdleLoop.Rejected)
+		return;
+
+	IdleLoop.Head = ~0U;
+	IdleLoop.Rejected = Head;
+
+	if (S9xIdleLoopValid(Branch, Head))
+	{
+		IdleLoop.Head = Head;
+		IdleLoop.Branch = Branch;
+		IdleLoop.Armed = FALSE;
+	}
+}
+
+// Called before the instruction at the start of the loop.
+static void S9xIdleLoopHead (void)
+{
+	if (IdleLoop.Armed && IdleLoop.Generation == IdleGeneration && CPU.Cycles > IdleLoop.Cycles &&
+		!CPU.IRQTransition && !CPU.IRQExternal && !(CPU.Flags & SCAN_KEYS_FLAG) &&
+		(!Settings.SA1 || S9xSA1CanRunBehind()) &&
+		!(IdleLoop.ReadsRDNMI && (Memory.FillRAM[0x4210] & 0x80)) &&
+		!memcmp(&IdleLoop.Registers, &Registers, sizeof(Registers)) &&
+		IdleLoop.Flags[0] == ICPU._Carry && IdleLoop.Flags[1] == ICPU._Zero &&
+		IdleLoop.Flags[2] == ICPU._Negative && IdleLoop.Flags[3] == ICPU._Overflow &&
+		IdleLoop.OpenBus == OpenBus && IdleLoop.PrevCycles - IdleLoop.Cycles == CPU.PrevCycles - CPU.Cycles &&
+		S9xIdleLoopValid(IdleLoop.Branch, IdleLoop.Head))
+	{
+		int32	period = CPU.Cycles - IdleLoop.Cycles;
+		int32	limit = CPU.NextCheck;
+
+		if (CPU.NMILine && Timings.NMITriggerPos < limit)
+			limit = Timings.NMITriggerPos;
+		if (IdleLoop.ReadsHVBJOY && IdleLoop.Cycles < Timings.HBlankEnd && Timings.HBlankEnd < limit)
+			limit = Timings.HBlankEnd;
+
+		if (limit > CPU.Cycles)
+		{
+			int32	passes = (limit - 1 - CPU.Cycles) / period;
+			CPU.Cycles += passes * period;
+			CPU.PrevCycles += passes * period;
+
+			if (Settings.SA1)
+				SA1.Behind += passes * IdleLoop.Instructions;
+		}
+	}
+
+	IdleLoop.Armed = TRUE;
+	IdleLoop.Generation = IdleGeneration;
+	IdleLoop.Cycles = CPU.Cycles;
+	IdleLoop.PrevCycles = CPU.PrevCycles;
+	memcpy(&IdleLoop.Registers, &Registers, sizeof(Registers));
+	IdleLoop.Flags[0] = ICPU._Carry;
+	IdleLoop.Flags[1] = ICPU._Zero;
+	IdleLoop.Flags[2] = ICPU._Negative;
+	IdleLoop.Flags[3] = ICPU._Overflow;
+	IdleLoop.OpenBus = OpenBus;
+}
+
+// MVN and MVP move one byte per pass, going back to the main loop in between.
+// Called after a pass that leaves more to do, this makes the following passes
+// at once as long as they stay within blocks of plain memory and can't reach
+// an event, an interrupt or the end of an index. The last pass is always left
+// to the opcode, so the instruction ends as usual. The SA-1 owes one step per
+// pass, which it takes when next caught up.
+static void S9xBlockMove (uint8 Op)
+{
+	if (!CPU.PCBase || (Registers.PCw & MEMMAP_MASK) + 3 >= MEMMAP_BLOCK_SIZE ||
+		CPU.IRQTransition || CPU.IRQExternal || (CPU.Flags & SCAN_KEYS_FLAG) ||
+		(Settings.SA1 && !S9xSA1CanRunBehind()) ||
+		(Registers.PBPC & 0xffffff) == IdleLoop.Head || Registers.A.W == 0)
+		return;
+
+	uint8	*code = CPU.PCBase + Registers.PCw;
+	bool8	forward = (Op == 0x54);
+	bool8	index8 = CheckEmulation() || CheckIndex();
+	uint32	src = (code[2] << 16) + Registers.X.W;
+	uint32	dst = (code[1] << 16) + Registers.Y.W;
+	int		srcblock = src >> MEMMAP_SHIFT;
+	int		dstblock = dst >> MEMMAP_SHIFT;
+	uint8	*srcbase = Memory.Map[srcblock];
+	uint8	*dstbase = Memory.WriteMap[dstblock];
+	int32	srcspeed = Memory.BlockSpeed[srcblock];
+	int32	dstspeed = Memory.BlockSpeed[dstblock];
+
+	if (srcbase < (uint8 *) CMemory::MAP_LAST || dstbase < (uint8 *) CMemory::MAP_LAST || !srcspeed || !dstspeed)
+		return;
+
+	// passes before the first index wraps or leaves its block
+	int32	n = Registers.A.W;
+	int32	wrap = index8 ? 0x100 : 0x10000;
+	int32	x = src & (wrap - 1), y = dst & (wrap - 1);
+	int32	left[4];
+
+	if (forward)
+	{
+		left[0] = wrap - x;
+		left[1] = wrap - y;
+		left[2] = MEMMAP_BLOCK_SIZE - (src & MEMMAP_MASK);
+		left[3] = MEMMAP_BLOCK_SIZE - (dst & MEMMAP_MASK);
+	}
+	else
+	{
+		left[0] = x + 1;
+		left[1] = y + 1;
+		left[2] = (src & MEMMAP_MASK) + 1;
+		left[3] = (dst & MEMMAP_MASK) + 1;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (left[i] < n)
+			n = left[i];
+	}
+
+	// and before an interrupt check, an event or the NMI: opcode fetch, two
+	// operands, the move and 2 internal cycles
+	int32	period = CPU.MemSpeed * 3 + srcspeed + dstspeed + TWO_CYCLES;
+	int32	limit = CPU.NextCheck;
+
+	if (CPU.NMILine && Timings.NMITriggerPos < limit)
+		limit = Timings.NMITriggerPos;
+	if (limit <= CPU.Cycles)
+		return;
+
+	if ((limit - 1 - CPU.Cycles) / period < n)
+		n = (limit - 1 - CPU.Cycles) / period;
+	if (n <= 0)
+		return;
+
+	uint8	*from = srcbase + (src & 0xffff);
+	uint8	*to = dstbase + (dst & 0xffff);
+	uint8	*first = forward ? to : to - (n - 1);
+
+	// the instruction could be overwriting itself
+	if (first < code + 3 && code < first + n)
+		return;
+
+	// byte by byte, as overlapping moves repeat what they just wrote
+	if (forward)
+	{
+		if (to <= from || to >= from + n)
+			memmove(to, from, n);
+		else
+		{
+			for (int32 i = 0; i < n; i++)
+				to[i] = from[i];
+		}
+	}
+	else
+	{
+		if (to >= from || to <= from - n)
+			memmove(to - (n - 1), from - (n - 1), n);
+		else
+		{
+			for (int32 i = 0; i < n; i++)
+				to[-i] = from[-i];
+		}
+	}
+
+#ifdef DEBUGGER
+	for (int32 i = 0; i < n; i++)
+	{
+		GilgameshAccessPointer(forward ? from + i : from - i, ACCESS_READ);
+		GilgameshAccessPointer(forward ? to + i : to - i, ACCESS_WRITE);
+	}
+#endif
+
+	OpenBus = forward ? to[n - 1] : to[-(n - 1)];
+
+	if (index8)
+	{
+		Registers.XL += forward ? n : -n;
+		Registers.YL += forward ? n : -n;
+	}
+	else
+	{
+		Registers.X.W += forward ? n : -n;
+		Registers.Y.W += forward ? n : -n;
+	}
+
+	Registers.A.W -= n;
+	CPU.Cycles += n * period;
+	CPU.PrevCycles = CPU.Cycles - TWO_CYCLES;
+
+	if (Settings.SA1)
+		SA1.Behind += n;
+}
+
+template <int Features>
+static void S9xMainLoopFeatures (void)
 {
+	// Traces and the debugger see the SA-1 in step with the S-CPU.
+	if (Settings.SA1)
+		S9xSA1ShareRAM(!(Features & (MAIN_LOOP_BREAK | MAIN_LOOP_TRACE | MAIN_LOOP_GILGAMESH)));
+
 	for (;;)
 	{
 		if (CPU.NMILine)
@@ -208,7 +567,9 @@ void S9xMainLoop (void)
 					Registers.PCw++;
 				}
 
+				S9xSA1Sync();
 				S9xOpcode_NMI();
+				IdleGeneration++;
 			}
 		}
 
@@ -226,46 +587,65 @@ void S9xMainLoop (void)
 
 				CPU.IRQTransition = FALSE;
 				CPU.IRQPending = Timings.IRQPendCount;
+				CPU.NextCheck = 0;
 
 				if (!CheckFlag(IRQ))
+				{
+					S9xSA1Sync();
 					S9xOpcode_IRQ();
+					IdleGeneration++;
+				}
 			}
 		}
 
 	#ifdef DEBUGGER
-		if ((CPU.Flags & BREAK_FLAG) && !(CPU.Flags & SINGLE_STEP_FLAG))
+		if (Features & MAIN_LOOP_BREAK)
 		{
-			for (int Break = 0; Break != 6; Break++)
+			if ((CPU.Flags & BREAK_FLAG) && !(CPU.Flags & SINGLE_STEP_FLAG) &&
+				S9xBreakpointAt(Registers.PB, Registers.PCw))
 			{
-				if (S9xBreakpoint[Break].Enabled &&
-					S9xBreakpoint[Break].Bank == Registers.PB &&
-					S9xBreakpoint[Break].Address == Registers.PCw)
-				{
-					if (S9xBreakpoint[Break].Enabled == 2)
-						S9xBreakpoint[Break].Enabled = TRUE;
-					else
-						CPU.Flags |= DEBUG_MODE_FLAG;
-				}
+				if (S9xBreakpointSkip == (Registers.PBPC & 0xffffff))
+					S9xBreakpointSkip = ~0;
+				else
+					CPU.Flags |= DEBUG_MODE_FLAG;
 			}
-		}
 
-		if (CPU.Flags & DEBUG_MODE_FLAG)
-			break;
+			if (CPU.Flags & DEBUG_MODE_FLAG)
+				break;
+		}
 
-		if (CPU.Flags & TRACE_FLAG)
+		if ((Features & MAIN_LOOP_TRACE) && (CPU.Flags & TRACE_FLAG))
 			S9xTrace();
-		GilgameshTrace(Registers.PB, Registers.PCw);
 
-		if (CPU.Flags & SINGLE_STEP_FLAG)
+		if (Features & MAIN_LOOP_GILGAMESH)
+			GilgameshTrace(Registers.PB, Registers.PCw);
+
+		if ((Features & MAIN_LOOP_BREAK) && (CPU.Flags & SINGLE_STEP_FLAG))
 		{
 			CPU.Flags &= ~SINGLE_STEP_FLAG;
 			CPU.Flags |= DEBUG_MODE_FLAG;
 		}
 	#endif
 
-		if (CPU.Flags & SCAN_KEYS_FLAG)
+		// Without the debugger hooks, STP, WDM and the trace toggle end the
+		// loop, so that S9xMainLoop picks a variant that handles them.
+		if (CPU.Flags & (SCAN_KEYS_FLAG
+		#ifdef DEBUGGER
+			| ((Features & MAIN_LOOP_BREAK) ? 0 : DEBUG_MODE_FLAG)
+			| ((Features & MAIN_LOOP_TRACE) ? 0 : TRACE_FLAG)
+		#endif
+			))
 			break;
 
+		uint32	pc = Registers.PBPC & 0xffffff;
+
+		if ((Features & MAIN_LOOP_IDLE) && pc == IdleLoop.Head)
+			S9xIdleLoopHead();
+
+	#ifdef DEBUGGER
+		uint64	OpcodeStart = (Features & MAIN_LOOP_GILGAMESH) ? GilgameshCycleBase + CPU.Cycles : 0;
+	#endif
+
 		register uint8				Op;
 		register struct	SOpcodes	*Opcodes;
 
@@ -274,7 +654,8 @@ void S9xMainLoop (void)
 			Op = CPU.PCBase[Registers.PCw];
 			CPU.PrevCycles = CPU.Cycles;
 			CPU.Cycles += CPU.MemSpeed;
-			S9xCheckInterrupts();
+			if (CPU.Cycles >= CPU.NextCheck)
+				S9xCheckInterrupts();
 			Opcodes = ICPU.S9xOpcodes;
 		}
 		else
@@ -287,8 +668,12 @@ void S9xMainLoop (void)
 		if ((Registers.PCw & MEMMAP_MASK) + ICPU.S9xOpLengths[Op] >= MEMMAP_BLOCK_SIZE)
 		{
 			uint8	*oldPCBase = CPU.PCBase;
+			uint32	next = ICPU.ShiftedPB + ((uint16) (Registers.PCw + 4));
 
-			CPU.PCBase = S9xGetBasePointer(ICPU.ShiftedPB + ((uint16) (Registers.PCw + 4)));
+			if (Memory.Map[next >> MEMMAP_SHIFT] == (uint8 *) CMemory::MAP_SA1_SHARED)
+				CPU.PCBase = NULL;
+			else
+				CPU.PCBase = S9xGetBasePointer(next);
 			if (oldPCBase != CPU.PCBase || (Registers.PCw & ~MEMMAP_MASK) == (0xffff & ~MEMMAP_MASK))
 				Opcodes = S9xOpcodesSlow;
 		}
@@ -296,10 +681,39 @@ void S9xMainLoop (void)
 		Registers.PCw++;
 		(*Opcodes[Op].S9xOpcode)();
 
+		if (!(Features & (MAIN_LOOP_BREAK | MAIN_LOOP_TRACE | MAIN_LOOP_GILGAMESH)) &&
+			(Op == 0x54 || Op == 0x44) && (Registers.PBPC & 0xffffff) == pc)
+			S9xBlockMove(Op);
+
+		if ((Features & MAIN_LOOP_IDLE) && (IdleOps[Op] == IDLE_BRANCH || Op == 0xcb))
+		{
+			uint32	head = Registers.PBPC & 0xffffff;
+			if (head <= pc && (head ^ pc) <= 0xffff)
+				S9xIdleLoopCandidate(pc, head);
+		}
+
+	#ifdef DEBUGGER
+		if (Features & MAIN_LOOP_GILGAMESH)
+		{
+			GilgameshPendingCount++;
+			GilgameshPendingCycles += (uint32) (GilgameshCycleBase + CPU.Cycles - OpcodeStart);
+		}
+	#endif
+
 		if (Settings.SA1)
-			S9xSA1MainLoop();
+		{
+			SA1.Behind++;
+			if (!S9xSA1CanRunBehind())
+				S9xSA1CatchUp();
+		}
 	}
 
+	// The frontend may save or snapshot Game Pak RAM between frames.
+	if (Settings.SuperFX)
+		S9xSuperFXSync();
+	if (Settings.SA1)
+		S9xSA1ShareRAM(FALSE);
+
 	S9xPackStatus();
 
 	if (CPU.Flags & SCAN_KEYS_FLAG)
@@ -309,6 +723,52 @@ void S9xMainLoop (void)
 	#endif
 		S9xSyncSpeed();
 		CPU.Flags &= ~SCAN_KEYS_FLAG;
+	#ifdef DEBUGGER
+		GilgameshFrameEnd();
+	#endif
+	}
+}
+
+// Picks the loop for the features in use, so that those off cost nothing.
+// Features turned on while it runs take effect at the next call.
+void S9xMainLoop (void)
+{
+	int	features = 0;
+
+#ifdef DEBUGGER
+	if (CPU.Flags & (DEBUG_MODE_FLAG | SINGLE_STEP_FLAG | BREAK_FLAG))
+		features |= MAIN_LOOP_BREAK;
+	if (CPU.Flags & TRACE_FLAG)
+		features |= MAIN_LOOP_TRACE;
+	if (GilgameshTracing)
+		features |= MAIN_LOOP_GILGAMESH;
+#endif
+
+	// Skipped passes would be missing from traces and the debugger.
+	if (Settings.SkipIdleLoops && !features)
+	{
+		if (!IdleOps[0x80])
+			S9xInitIdleOps();
+
+		// Memory may have been changed between frames (cheats, snapshots).
+		IdleLoop.Armed = FALSE;
+		IdleLoop.Rejected = ~0U;
+		features = MAIN_LOOP_IDLE;
+	}
+
+	switch (features)
+	{
+		case 0:	S9xMainLoopFeatures<0>(); break;
+	#ifdef DEBUGGER
+		case 1:	S9xMainLoopFeatures<1>(); break;
+		case 2:	S9xMainLoopFeatures<2>(); break;
+		case 3:	S9xMainLoopFeatures<3>(); break;
+		case 4:	S9xMainLoopFeatures<4>(); break;
+		case 5:	S9xMainLoopFeatures<5>(); break;
+		case 6:	S9xMainLoopFeatures<6>(); break;
+		case 7:	S9xMainLoopFeatures<7>(); break;
+	#endif
+		case MAIN_LOOP_IDLE:	S9xMainLoopFeatures<MAIN_LOOP_IDLE>(); break;
 	}
 }
 
@@ -363,6 +823,12 @@ void S9xDoHEventProcessing (void)
 	};
 #endif
 
+	IdleGeneration++;
+
+	// The SA-1 runs at most up to the next event (CPU.NextCheck), and is
+	// caught up before HDMA and the end of the line.
+	S9xSA1Sync();
+
 #ifdef DEBUGGER
 	if (Settings.TraceHCEvent)
 		S9xTraceFormattedMessage("--- HC event processing  (%s)  expected HC:%04d  executed HC:%04d",
@@ -397,6 +863,9 @@ void S9xDoHEventProcessing (void)
 			}
 
 			S9xAPUEndScanline();
+		#ifdef DEBUGGER
+			GilgameshCycleBase += Timings.H_Max;
+		#endif
 			CPU.Cycles -= Timings.H_Max;
 			CPU.PrevCycles -= Timings.H_Max;
 			S9xAPUSetReferenceTime(CPU.Cycles);
@@ -552,4 +1021,6 @@ void S9xDoHEventProcessing (void)
 		S9xTraceFormattedMessage("--- HC event rescheduled (%s)  expected HC:%04d  current  HC:%04d",
 			eventname[CPU.WhichEvent], CPU.NextEvent, CPU.Cycles);
 #endif
+
+	S9xUpdateCheckBudget();
 }
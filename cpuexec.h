@@ -271,6 +271,29 @@ static inline void S9xFixCycles (void)
 	}
 }
 
+// Up to CPU.NextCheck, neither S9xCheckInterrupts() nor S9xDoHEventProcessing()
+// would change anything, so adding cycles is all a memory access has to do.
+// Whatever changes what they depend on must reset CPU.NextCheck to 0.
+static inline void S9xUpdateCheckBudget (void)
+{
+	int32	budget = CPU.NextEvent < Timings.H_Max ? CPU.NextEvent : Timings.H_Max;
+	bool8	timers = PPU.HTimerEnabled || PPU.VTimerEnabled;
+	bool8	thisIRQ = timers && (!PPU.VTimerEnabled || CPU.V_Counter == PPU.VTimerPosition);
+
+	// The H timer only raises the IRQ for the access that crosses its position.
+	if (thisIRQ && PPU.HTimerEnabled)
+	{
+		if (CPU.Cycles < PPU.HTimerPosition && PPU.HTimerPosition < budget)
+			budget = PPU.HTimerPosition;
+		thisIRQ = FALSE;
+	}
+
+	if (thisIRQ != CPU.IRQLastState || (CPU.IRQLine && timers && !CPU.IRQTransition))
+		budget = 0;
+
+	CPU.NextCheck = budget;
+}
+
 static inline void S9xCheckInterrupts (void)
 {
 	bool8	thisIRQ = PPU.HTimerEnabled || PPU.VTimerEnabled;
@@ -308,6 +331,7 @@ static inline void S9xCheckInterrupts (void)
 	}
 
 	CPU.IRQLastState = thisIRQ;
+	S9xUpdateCheckBudget();
 }
 
 #endif
@@ -192,7 +192,7 @@
 #ifdef SA1_OPCODES
 #define AddCycles(n)	{ SA1.Cycles += (n); }
 #else
-#define AddCycles(n)	{ CPU.PrevCycles = CPU.Cycles; CPU.Cycles += (n); S9xCheckInterrupts(); while (CPU.Cycles >= CPU.NextEvent) S9xDoHEventProcessing(); }
+#define AddCycles(n)	{ CPU.PrevCycles = CPU.Cycles; CPU.Cycles += (n); if (CPU.Cycles >= CPU.NextCheck) { S9xCheckInterrupts(); while (CPU.Cycles >= CPU.NextEvent) S9xDoHEventProcessing(); } }
 #endif
 
 #include "cpuaddr.h"
@@ -2822,7 +2822,11 @@ void S9xOpcode_IRQ (void)
 	}
 
 #ifdef DEBUGGER
-	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_IRQ);
+#ifdef SA1_OPCODES
+	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_IRQ, PROCESSOR_SA1);
+#else
+	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_IRQ, PROCESSOR_CPU);
+#endif
 #endif
 }
 
@@ -2901,7 +2905,11 @@ void S9xOpcode_NMI (void)
 	}
 
 #ifdef DEBUGGER
-	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_NMI);
+#ifdef SA1_OPCODES
+	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_NMI, PROCESSOR_SA1);
+#else
+	GilgameshTraceVector(Registers.PC.xPBPC, VECTOR_NMI, PROCESSOR_CPU);
+#endif
 #endif
 }
 
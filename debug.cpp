@@ -179,6 +179,8 @@
 #ifdef DEBUGGER
 
 #include <stdarg.h>
+#include <map>
+#include <set>
 #include "snes9x.h"
 #include "memmap.h"
 #include "cpuops.h"
@@ -194,6 +196,19 @@ extern FILE	*apu_trace;
 FILE		*trace = NULL, *trace2 = NULL;
 
 struct SBreakPoint	S9xBreakpoint[6];
+uint8				*S9xBreakpointBits[0x100];
+uint32				S9xBreakpointSkip = ~0;
+
+// Added with ba (by address) and br/bw (by address, to their byte count).
+static std::set<uint32>				Breakpoints;
+static std::map<uint32, uint16>		Watchpoints[2];
+
+// Watched addresses, mirrors included, as one bit per address of a bank.
+// Blocks holding one have their Map (or WriteMap) entry swapped for
+// MAP_WATCH, the original entry being kept in WatchMap.
+static uint8	*WatchBits[2][0x100];
+static uint8	*WatchMap[2][MEMMAP_NUM_BLOCKS];
+static bool8	WatchBlock[2][MEMMAP_NUM_BLOCKS];
 
 struct SDebug
 {
@@ -223,6 +238,12 @@ static const char	*HelpMessage[] =
 	"s                      - Skip to next instruction    [skip]",
 	"T                      - Toggle CPU instruction tracing to trace.log",
 	"TS                     - Toggle SA-1 instruction tracing to trace_sa1.log",
+	"G                      - Toggle Gilgamesh tracing to gilgamesh.db",
+	"GR [Range]             - Only trace code in [Range], or anywhere",
+	"                         [for example: GR $00:8000-$00:FFFF]",
+	"GF [First] [Last]      - Only trace frames [First] to [Last] (0: no end), or all",
+	"GS [N]                 - Only trace 1 instruction in [N]",
+	"GV                     - View the Gilgamesh trace filter",
 	"E                      - Toggle HC-based event tracing to trace.log",
 	"V                      - Toggle non-DMA V-RAM read/write tracing to stdout",
 	"D                      - Toggle on-screen DMA tracing",
@@ -237,6 +258,13 @@ static const char	*HelpMessage[] =
 	"bs [Number] [Address]  - Enable/disable breakpoint",
 	"                         [enable example: bs #2 $02:8002]",
 	"                         [disable example: bs #2]",
+	"ba [Address]           - Add breakpoint, beyond the numbered ones",
+	"br [Address] [Number]  - Add read watchpoint on [Number] bytes (default: 1)",
+	"bw [Address] [Number]  - Add write watchpoint on [Number] bytes (default: 1)",
+	"                         [example: bw $7E:0100 #2]",
+	"bd [Address]           - Delete added breakpoint and watchpoints at [Address]",
+	"bc                     - Clear added breakpoints and watchpoints",
+	"bl                     - List added breakpoints and watchpoints",
 	"c                      - Dump SNES colour palette",
 	"W                      - Show what SNES hardware features the ROM is using",
 	"                         which might not be implemented yet",
@@ -331,6 +359,9 @@ static void debug_print_window (uint8 *);
 static const char * debug_clip_fn (int);
 static void debug_whats_used (void);
 static void debug_whats_missing (void);
+static void debug_set_breakpoint (int, bool8, uint8, uint16);
+static void debug_update_breakpoint (uint32);
+static void debug_update_watches (void);
 
 uint8 S9xDebugGetByte (uint32 Address)
 {
@@ -338,6 +369,9 @@ uint8 S9xDebugGetByte (uint32 Address)
 	uint8	*GetAddress = Memory.Map[block];
 	uint8	byte = 0;
 
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		GetAddress = WatchMap[WATCH_READ][block];
+
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		byte = *(GetAddress + (Address & 0xffff));
@@ -364,6 +398,21 @@ uint8 S9xDebugGetByte (uint32 Address)
 			byte = *(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
 			return (byte);
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			return (S9xDebugGetByte(Address));
+
+		case CMemory::MAP_SA1_SHARED:
+		{
+			uint8	*map = S9xSA1SharedMap(Address);
+
+			if (map == (uint8 *) CMemory::MAP_BWRAM)
+				return (*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)));
+			if (map >= (uint8 *) CMemory::MAP_LAST)
+				return (*(map + (Address & 0xffff)));
+			return (byte);
+		}
+
 		default:
 			return (byte);
 	}
@@ -379,6 +428,229 @@ uint16 S9xDebugGetWord (uint32 Address)
 	return (word);
 }
 
+static void debug_set_bit (uint8 **Bits, uint32 Address, bool8 On)
+{
+	uint8	*bank = Bits[(Address >> 16) & 0xff];
+
+	if (!bank)
+	{
+		if (!On)
+			return;
+
+		bank = Bits[(Address >> 16) & 0xff] = (uint8 *) calloc(0x10000 >> 3, 1);
+	}
+
+	if (On)
+		bank[(Address & 0xffff) >> 3] |=  (1 << (Address & 7));
+	else
+		bank[(Address & 0xffff) >> 3] &= ~(1 << (Address & 7));
+}
+
+static void debug_set_breakpoint (int Number, bool8 Enabled, uint8 Bank, uint16 Address)
+{
+	uint32	old = (S9xBreakpoint[Number].Bank << 16) | S9xBreakpoint[Number].Address;
+
+	S9xBreakpoint[Number].Enabled = Enabled;
+	if (Enabled)
+	{
+		S9xBreakpoint[Number].Bank = Bank;
+		S9xBreakpoint[Number].Address = Address;
+	}
+
+	debug_update_breakpoint(old);
+	debug_update_breakpoint((Bank << 16) | Address);
+}
+
+// Sets the bit of Address if any breakpoint, numbered or added, is there.
+static void debug_update_breakpoint (uint32 Address)
+{
+	bool8	on = Breakpoints.count(Address) != 0;
+
+	for (int i = 0; i != 6; i++)
+	{
+		if (S9xBreakpoint[i].Enabled &&
+			S9xBreakpoint[i].Bank == (Address >> 16) &&
+			S9xBreakpoint[i].Address == (Address & 0xffff))
+			on = TRUE;
+	}
+
+	debug_set_bit(S9xBreakpointBits, Address, on);
+}
+
+static uint8 ** debug_watch_map (int Kind)
+{
+	return (Kind == WATCH_READ ? Memory.Map : Memory.WriteMap);
+}
+
+static uint8 * debug_watch_original (int Kind, int Block)
+{
+	return (WatchBlock[Kind][Block] ? WatchMap[Kind][Block] : debug_watch_map(Kind)[Block]);
+}
+
+static void debug_watch_address (int Kind, uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	**map = debug_watch_map(Kind);
+
+	debug_set_bit(WatchBits[Kind], Address, TRUE);
+
+	if (!WatchBlock[Kind][block])
+	{
+		WatchMap[Kind][block] = map[block];
+		WatchBlock[Kind][block] = TRUE;
+		map[block] = (uint8 *) CMemory::MAP_WATCH;
+	}
+}
+
+// Watches Address, and every mirror of it when it is plain memory.
+static void debug_watch_byte (int Kind, uint32 Address)
+{
+	uint8	*base = debug_watch_original(Kind, (Address & 0xffffff) >> MEMMAP_SHIFT);
+
+	if (base < (uint8 *) CMemory::MAP_LAST)
+	{
+		debug_watch_address(Kind, Address);
+		return;
+	}
+
+	uint8	*byte = base + (Address & 0xffff);
+
+	for (int block = 0; block != MEMMAP_NUM_BLOCKS; block++)
+	{
+		uint8	*other = debug_watch_original(Kind, block);
+		if (other < (uint8 *) CMemory::MAP_LAST)
+			continue;
+
+		uint8	*start = other + ((block << MEMMAP_SHIFT) & 0xffff);
+		if ((size_t) (byte - start) < MEMMAP_BLOCK_SIZE)
+			debug_watch_address(Kind, (block << MEMMAP_SHIFT) + (byte - start));
+	}
+}
+
+// Puts the maps back as they were, then redirects the blocks of every watchpoint.
+static void debug_update_watches (void)
+{
+	for (int kind = WATCH_READ; kind <= WATCH_WRITE; kind++)
+	{
+		uint8	**map = debug_watch_map(kind);
+
+		for (int block = 0; block != MEMMAP_NUM_BLOCKS; block++)
+		{
+			if (WatchBlock[kind][block] && map[block] == (uint8 *) CMemory::MAP_WATCH)
+				map[block] = WatchMap[kind][block];
+			WatchBlock[kind][block] = FALSE;
+		}
+
+		for (int bank = 0; bank != 0x100; bank++)
+		{
+			free(WatchBits[kind][bank]);
+			WatchBits[kind][bank] = NULL;
+		}
+
+		for (std::map<uint32, uint16>::iterator i = Watchpoints[kind].begin(); i != Watchpoints[kind].end(); ++i)
+		{
+			for (uint32 offset = 0; offset != i->second; offset++)
+				debug_watch_byte(kind, (i->first + offset) & 0xffffff);
+		}
+	}
+}
+
+// Stops at the next instruction if the access touches a watched byte.
+static void debug_watch_hit (int Kind, uint32 Address, int Bytes)
+{
+	for (int i = 0; i != Bytes; i++)
+	{
+		uint32	a = (Address + i) & 0xffffff;
+		uint8	*bits = WatchBits[Kind][a >> 16];
+
+		if (bits && (bits[(a & 0xffff) >> 3] & (1 << (a & 7))))
+		{
+			if (!(CPU.Flags & DEBUG_MODE_FLAG))
+				printf("%s watchpoint @ $%02X:%04X\n", Kind == WATCH_READ ? "Read" : "Write", a >> 16, a & 0xffff);
+
+			CPU.Flags |= DEBUG_MODE_FLAG;
+			return;
+		}
+	}
+}
+
+// Swaps the original entry in for the access, then traps the block again,
+// keeping any remapping the access itself made.
+static void debug_watch_unmap (int Kind, int Block)
+{
+	debug_watch_map(Kind)[Block] = WatchMap[Kind][Block];
+}
+
+static void debug_watch_remap (int Kind, int Block)
+{
+	uint8	**map = debug_watch_map(Kind);
+
+	// unless the access remapped memory, and the watches were set up again
+	if (!WatchBlock[Kind][Block] || map[Block] == (uint8 *) CMemory::MAP_WATCH)
+		return;
+
+	WatchMap[Kind][Block] = map[Block];
+	map[Block] = (uint8 *) CMemory::MAP_WATCH;
+}
+
+// The entries written over a MAP_WATCH are the new originals, and mirrors may have moved.
+void S9xWatchMapChanged (void)
+{
+	if (!Watchpoints[WATCH_READ].empty() || !Watchpoints[WATCH_WRITE].empty())
+		debug_update_watches();
+}
+
+uint8 * S9xWatchMap (uint32 Address)
+{
+	return (WatchMap[WATCH_READ][(Address & 0xffffff) >> MEMMAP_SHIFT]);
+}
+
+uint8 S9xWatchGetByte (uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	byte;
+
+	debug_watch_hit(WATCH_READ, Address, 1);
+	debug_watch_unmap(WATCH_READ, block);
+	byte = S9xGetByte(Address);
+	debug_watch_remap(WATCH_READ, block);
+
+	return (byte);
+}
+
+uint16 S9xWatchGetWord (uint32 Address, enum s9xwrap_t w)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint16	word;
+
+	debug_watch_hit(WATCH_READ, Address, 2);
+	debug_watch_unmap(WATCH_READ, block);
+	word = S9xGetWord(Address, w);
+	debug_watch_remap(WATCH_READ, block);
+
+	return (word);
+}
+
+void S9xWatchSetByte (uint8 Byte, uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+
+	debug_watch_hit(WATCH_WRITE, Address, 1);
+	debug_watch_unmap(WATCH_WRITE, block);
+	S9xSetByte(Byte, Address);
+	debug_watch_remap(WATCH_WRITE, block);
+}
+
+void S9xWatchSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w, enum s9xwriteorder_t o)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+
+	debug_watch_hit(WATCH_WRITE, Address, 2);
+	debug_watch_unmap(WATCH_WRITE, block);
+	S9xSetWord(Word, Address, w, o);
+	debug_watch_remap(WATCH_WRITE, block);
+}
+
 static uint8 S9xDebugSA1GetByte (uint32 Address)
 {
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
@@ -1558,6 +1830,51 @@ static void debug_process_command (char *Line)
 		}
 	}
 
+	if (*Line == 'G')
+	{
+		SGilgameshFilter	&filter = GilgameshFilter;
+
+		switch (Line[1])
+		{
+			case 'R':
+				if (Line[2] == 0)
+					filter.Ranges.clear();
+				else
+				if (!GilgameshParseRanges(Line + 2))
+					printf("Invalid range.\n");
+				break;
+
+			case 'F':
+				if (sscanf(Line + 2, "%u %u", &filter.FirstFrame, &filter.LastFrame) != 2)
+				{
+					filter.FirstFrame = 0;
+					filter.LastFrame = UINT32_MAX;
+				}
+				break;
+
+			case 'S':
+				if (sscanf(Line + 2, "%u", &filter.Sampling) != 1)
+					filter.Sampling = 1;
+				break;
+
+			case 'V':
+				break;
+
+			default:
+				filter.Enabled = !filter.Enabled;
+				break;
+		}
+
+		GilgameshApplyFilter();
+
+		printf("Gilgamesh tracing %s, frames %u to %u, 1 instruction in %u", filter.Enabled ? "enabled" : "disabled",
+			   filter.FirstFrame, filter.LastFrame, filter.Sampling);
+		for (size_t i = 0; i < filter.Ranges.size(); i++)
+			printf("%s$%02X:%04X-$%02X:%04X", i ? ", " : ", in ", filter.Ranges[i].first >> 16, filter.Ranges[i].first & 0xffff,
+				   filter.Ranges[i].second >> 16, filter.Ranges[i].second & 0xffff);
+		printf(".\n");
+	}
+
 	if (*Line == 'E')
 	{
 		Settings.TraceHCEvent = !Settings.TraceHCEvent;
@@ -1649,18 +1966,14 @@ static void debug_process_command (char *Line)
 
 	if (*Line == 'p')
 	{
-		S9xBreakpoint[5].Enabled = FALSE;
+		debug_set_breakpoint(5, FALSE, 0, 0);
 		Address += debug_cpu_op_print(string, Bank, Address);
 
 		if (strncmp(&string[18], "JMP", 3) != 0 &&
 		    strncmp(&string[18], "JML", 3) != 0 &&
 		    strncmp(&string[18], "RT" , 2) != 0 &&
 		    strncmp(&string[18], "BRA", 3))
-		{
-			S9xBreakpoint[5].Enabled = TRUE;
-			S9xBreakpoint[5].Bank = Bank;
-			S9xBreakpoint[5].Address = Address;
-		}
+			debug_set_breakpoint(5, TRUE, Bank, Address);
 		else
 		{
 			CPU.Flags |= SINGLE_STEP_FLAG;
@@ -1680,12 +1993,10 @@ static void debug_process_command (char *Line)
 			if (Hold < 5)
 			{
 				if (debug_get_start_address(Line + 5, &Bank, &Address) == -1)
-					S9xBreakpoint[Hold].Enabled = FALSE;
+					debug_set_breakpoint(Hold, FALSE, 0, 0);
 				else
 				{
-					S9xBreakpoint[Hold].Enabled = TRUE;
-					S9xBreakpoint[Hold].Bank = Bank;
-					S9xBreakpoint[Hold].Address = Address;
+					debug_set_breakpoint(Hold, TRUE, Bank, Address);
 					CPU.Flags |= BREAK_FLAG;
 				}
 			}
@@ -1693,6 +2004,86 @@ static void debug_process_command (char *Line)
 			Line[1] = 'v';
 		}
 
+		if (Line[1] == 'a' || Line[1] == 'r' || Line[1] == 'w' || Line[1] == 'd')
+		{
+			if (debug_get_start_address(Line + 1, &Bank, &Address) != -1)
+			{
+				uint32	a = (Bank << 16) | (Address & 0xffff);
+				char	*count = strchr(Line, '#');
+
+				Hold = 1;
+				if (count)
+					debug_get_number(count, &Hold);
+
+				switch (Line[1])
+				{
+					case 'a':
+						Breakpoints.insert(a);
+						debug_update_breakpoint(a);
+						CPU.Flags |= BREAK_FLAG;
+						break;
+
+					case 'r':
+						Watchpoints[WATCH_READ][a] = Hold ? Hold : 1;
+						CPU.Flags |= BREAK_FLAG;
+						break;
+
+					case 'w':
+						Watchpoints[WATCH_WRITE][a] = Hold ? Hold : 1;
+						CPU.Flags |= BREAK_FLAG;
+						break;
+
+					case 'd':
+						Breakpoints.erase(a);
+						debug_update_breakpoint(a);
+						Watchpoints[WATCH_READ].erase(a);
+						Watchpoints[WATCH_WRITE].erase(a);
+						break;
+				}
+
+				debug_update_watches();
+			}
+
+			Line[1] = 'l';
+		}
+
+		if (Line[1] == 'c')
+		{
+			std::set<uint32>	cleared;
+
+			cleared.swap(Breakpoints);
+			for (std::set<uint32>::iterator i = cleared.begin(); i != cleared.end(); ++i)
+				debug_update_breakpoint(*i);
+
+			Watchpoints[WATCH_READ].clear();
+			Watchpoints[WATCH_WRITE].clear();
+			debug_update_watches();
+
+			Line[1] = 'l';
+		}
+
+		if (Line[1] == 'l')
+		{
+			debug_line_print("Added breakpoints:");
+
+			for (std::set<uint32>::iterator i = Breakpoints.begin(); i != Breakpoints.end(); ++i)
+			{
+				sprintf(string, "$%02X:%04X", *i >> 16, *i & 0xffff);
+				debug_line_print(string);
+			}
+
+			for (int kind = WATCH_READ; kind <= WATCH_WRITE; kind++)
+			{
+				debug_line_print(kind == WATCH_READ ? "Read watchpoints:" : "Write watchpoints:");
+
+				for (std::map<uint32, uint16>::iterator i = Watchpoints[kind].begin(); i != Watchpoints[kind].end(); ++i)
+				{
+					sprintf(string, "$%02X:%04X #%u", i->first >> 16, i->first & 0xffff, i->second);
+					debug_line_print(string);
+				}
+			}
+		}
+
 		if (Line[1] == 'v')
 		{
 			Number = 0;
@@ -1751,34 +2142,28 @@ static void debug_process_command (char *Line)
 
 	if (*Line == 'g')
 	{
-		S9xBreakpoint[5].Enabled = FALSE;
+		debug_set_breakpoint(5, FALSE, 0, 0);
 
-		bool8	found = FALSE;
+		// Watchpoints too need the main loop to check for DEBUG_MODE_FLAG.
+		bool8	found = !Breakpoints.empty() || !Watchpoints[WATCH_READ].empty() || !Watchpoints[WATCH_WRITE].empty();
 
 		for (int i = 0; i < 5; i++)
 		{
 			if (S9xBreakpoint[i].Enabled)
-			{
 				found = TRUE;
-
-				if (S9xBreakpoint[i].Bank == Registers.PB && S9xBreakpoint[i].Address == Registers.PCw)
-				{
-					S9xBreakpoint[i].Enabled = 2;
-					break;
-				}
-			}
 		}
 
 		if (!found)
 			CPU.Flags &= ~BREAK_FLAG;
 
+		// Leave the breakpoint we are stopped at, if any, without hitting it again.
+		S9xBreakpointSkip = S9xBreakpointAt(Registers.PB, Registers.PCw) ? (Registers.PBPC & 0xffffff) : ~0;
+
 		ErrorCode = debug_get_start_address(Line, &Bank, &Address);
 
 		if (ErrorCode == 1)
 		{
-			S9xBreakpoint[5].Enabled = TRUE;
-			S9xBreakpoint[5].Bank = Bank;
-			S9xBreakpoint[5].Address = Address;
+			debug_set_breakpoint(5, TRUE, Bank, Address);
 			CPU.Flags |= BREAK_FLAG;
 		}
 
@@ -2555,6 +2940,7 @@ void S9xDoDebug (void)
 		Cycles = CPU.Cycles;
 		debug_process_command(Line);
 		CPU.Cycles = Cycles;
+		CPU.NextCheck = 0;
 	}
 
 	if (!(CPU.Flags & SINGLE_STEP_FLAG))
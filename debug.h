@@ -198,7 +198,23 @@ struct SBreakPoint
 		fp = fopen(fn.c_str(), mode); \
 	}
 
+enum
+{
+	WATCH_READ,
+	WATCH_WRITE
+};
+
 extern struct SBreakPoint	S9xBreakpoint[6];
+extern uint8				*S9xBreakpointBits[0x100];
+extern uint32				S9xBreakpointSkip;
+
+// One bit per address of the banks holding a breakpoint, NULL for the others.
+static inline bool8 S9xBreakpointAt (uint8 Bank, uint16 Address)
+{
+	uint8	*bits = S9xBreakpointBits[Bank];
+
+	return (bits && (bits[Address >> 3] & (1 << (Address & 7))));
+}
 
 void S9xDoDebug (void);
 void S9xTrace (void);
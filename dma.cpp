@@ -222,6 +222,61 @@ static inline bool8 addCyclesInDMA (uint8 dma_channel)
 	return (TRUE);
 }
 
+// Number of DMA bytes that can be transferred before an interrupt check or an HC event
+// is due. Their addCyclesInDMA() would do nothing but add the cycles.
+static inline int32 DMABytesToNextCheck (void)
+{
+	if (CPU.Cycles >= CPU.NextCheck)
+		return (0);
+
+	return ((CPU.NextCheck - CPU.Cycles - 1) / SLOW_ONE_CYCLE);
+}
+
+// Word VMDATA writes ($2118/$2119 with the address incremented by 1 after the high byte)
+// go to consecutive VRAM addresses: copy them and drop the tile caches they overlap at once.
+// b is 1 if the first byte is a high one.
+static void DMAWriteVRAMLinear (const uint8 *src, int32 bytes, int32 b)
+{
+	uint32	address = ((PPU.VMA.Address << 1) + b) & 0xffff;
+
+	PPU.VMA.Address += (b + bytes) >> 1;
+
+	while (bytes > 0)
+	{
+		int32	n = 0x10000 - address;
+		if (n > bytes)
+			n = bytes;
+
+		uint32	last = address + n - 1;
+
+		memcpy(Memory.VRAM + address, src, n);
+
+	#ifdef DEBUGGER
+		for (int32 i = 0; i < n; i++)
+		{
+			GilgameshAccess(MEMORY_VRAM, address + i, ACCESS_WRITE, CPU.InDMAorHDMA);
+			GilgameshAccessPointer(src + i, ACCESS_READ);
+		}
+	#endif
+
+		memset(IPPU.TileCached[TILE_2BIT] + (address >> 4), FALSE, (last >> 4) - (address >> 4) + 1);
+		memset(IPPU.TileCached[TILE_4BIT] + (address >> 5), FALSE, (last >> 5) - (address >> 5) + 1);
+		memset(IPPU.TileCached[TILE_8BIT] + (address >> 6), FALSE, (last >> 6) - (address >> 6) + 1);
+		memset(IPPU.TileCached[TILE_2BIT_EVEN] + (address >> 4), FALSE, (last >> 4) - (address >> 4) + 1);
+		memset(IPPU.TileCached[TILE_2BIT_ODD]  + (address >> 4), FALSE, (last >> 4) - (address >> 4) + 1);
+		memset(IPPU.TileCached[TILE_4BIT_EVEN] + (address >> 5), FALSE, (last >> 5) - (address >> 5) + 1);
+		memset(IPPU.TileCached[TILE_4BIT_ODD]  + (address >> 5), FALSE, (last >> 5) - (address >> 5) + 1);
+		IPPU.TileCached[TILE_2BIT_EVEN][((address >> 4) - 1) & (MAX_2BIT_TILES - 1)] = FALSE;
+		IPPU.TileCached[TILE_2BIT_ODD] [((address >> 4) - 1) & (MAX_2BIT_TILES - 1)] = FALSE;
+		IPPU.TileCached[TILE_4BIT_EVEN][((address >> 5) - 1) & (MAX_4BIT_TILES - 1)] = FALSE;
+		IPPU.TileCached[TILE_4BIT_ODD] [((address >> 5) - 1) & (MAX_4BIT_TILES - 1)] = FALSE;
+
+		address = (address + n) & 0xffff;
+		src += n;
+		bytes -= n;
+	}
+}
+
 bool8 S9xDoDMA (uint8 Channel)
 {
 	CPU.InDMA = TRUE;
@@ -358,6 +413,8 @@ bool8 S9xDoDMA (uint8 Channel)
 
 	if (Settings.SA1)
 	{
+		S9xSA1Sync();
+
 		if (SA1.in_char_dma && d->BAddress == 0x18 && (d->ABank & 0xf0) == 0x40)
 		{
 			// Perform packed bitmap to PPU character format conversion on the data
@@ -555,8 +612,18 @@ bool8 S9xDoDMA (uint8 Channel)
 		inWRAM_DMA = ((!in_sa1_dma && !in_sdd1_dma && !spc7110_dma) &&
 			(d->ABank == 0x7e || d->ABank == 0x7f || (!(d->ABank & 0x40) && d->AAddress < 0x2000)));
 
+		// The fast path reads through base, behind the back of S9xGetByte
+	#ifdef DEBUGGER
+		#define	TRACE_FAST_READ \
+			if (base) \
+				GilgameshAccessPointer(base + p, ACCESS_READ);
+	#else
+		#define	TRACE_FAST_READ
+	#endif
+
 		// 8 cycles per byte
 		#define	UPDATE_COUNTERS \
+			TRACE_FAST_READ \
 			d->TransferBytes--; \
 			d->AAddress += inc; \
 			p += inc; \
@@ -835,6 +902,43 @@ bool8 S9xDoDMA (uint8 Channel)
 					if (d->BAddress == 0x18)
 					{
 						// VMDATAL
+						if (!PPU.VMA.FullGraphicCount && inc == 1 && PPU.VMA.High && PPU.VMA.Increment == 1)
+						{
+							// Bulk upload, one byte at a time only where events are due
+							do
+							{
+								int32	n = 0;
+
+								if (PPU.ForcedBlanking || CPU.V_Counter >= PPU.ScreenHeight + FIRST_VISIBLE_LINE)
+									n = DMABytesToNextCheck();
+								if (n > count)
+									n = count;
+
+								if (n > 0)
+								{
+									DMAWriteVRAMLinear(base + p, n, b);
+									b = (b + n) & 1;
+									count -= n;
+									d->TransferBytes -= n;
+									d->AAddress += n;
+									p += n;
+									CPU.PrevCycles = CPU.Cycles + (n - 1) * SLOW_ONE_CYCLE;
+									CPU.Cycles += n * SLOW_ONE_CYCLE;
+
+									if (count == 0)
+										break;
+								}
+
+								Work = *(base + p);
+								if (b)
+									REGISTER_2119_linear(Work);
+								else
+									REGISTER_2118_linear(Work);
+								UPDATE_COUNTERS;
+								b ^= 1;
+							} while (--count > 0);
+						}
+						else
 						if (!PPU.VMA.FullGraphicCount)
 						{
 							switch (b)
@@ -1045,6 +1149,7 @@ bool8 S9xDoDMA (uint8 Channel)
 		}
 
 		#undef UPDATE_COUNTERS
+		#undef TRACE_FAST_READ
 	}
     else
     {
@@ -1426,6 +1531,12 @@ uint8 S9xDoHDMA (uint8 byte)
 	temp = CPU.InWRAMDMAorHDMA;
 	tmpch = CPU.CurrentDMAorHDMAChannel;
 
+#ifdef DEBUGGER
+	// Attributed to the instruction that enabled HDMA, not to the one it interrupts
+	uint32	pc = GilgameshPC;
+	GilgameshPC = GilgameshHDMAPC;
+#endif
+
 	// XXX: Not quite right...
 	ADD_CYCLES(Timings.DMACPUSync);
 
@@ -1614,6 +1725,10 @@ uint8 S9xDoHDMA (uint8 byte)
 						else
 						{
 							// HDMA FAST PATH
+						#ifdef DEBUGGER
+							for (int i = 0; i < HDMA_ModeByteCounts[p->TransferMode]; i++)
+								GilgameshAccessPointer(HDMAMemPointers[d] + i, ACCESS_READ);
+						#endif
 							switch (p->TransferMode)
 							{
 								case 0:
@@ -1773,6 +1888,10 @@ uint8 S9xDoHDMA (uint8 byte)
 	CPU.InWRAMDMAorHDMA = temp;
 	CPU.CurrentDMAorHDMAChannel = tmpch;
 
+#ifdef DEBUGGER
+	GilgameshPC = pc;
+#endif
+
 	return (byte);
 }
 
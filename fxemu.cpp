@@ -176,18 +176,50 @@
  ***********************************************************************************/
 
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "snes9x.h"
 #include "memmap.h"
+#include "getset.h"
 #include "fxinst.h"
 #include "fxemu.h"
 
+// The blocks Map_SuperFXLoROMMap() points at Game Pak RAM: $6000-$7fff of
+// banks $00-$3f and $80-$bf, and banks $70-$71.
+#define FX_RAM_BLOCKS	(2 * 128 + 2 * 16)
+
+extern uint8	*HDMAMemPointers[8];
+
+// With Settings.SuperFXThread, a line of GSU work can run on a thread while
+// the CPU runs the next line. The Game Pak RAM blocks are redirected to
+// MAP_SUPERFX_RAM meanwhile, so that the CPU, DMA and HDMA wait for it
+// (S9xSuperFXSync) before touching the RAM, as they do for $3000-$32ff.
+static struct FxThread_s
+{
+	std::mutex				Mutex;
+	std::condition_variable	Wake;
+	std::atomic<uint32>		Job;		// instructions to run, 0 when done
+	std::atomic<bool>		Sleeping;
+}	*FxThread = NULL;
+
+static bool8	FxRunningAhead = FALSE;
+static const bool8	FxThreadPays = std::thread::hardware_concurrency() > 1;
+static int		FxRAMBlock[FX_RAM_BLOCKS];
+static uint8	*FxRAMMap[FX_RAM_BLOCKS], *FxRAMWriteMap[FX_RAM_BLOCKS];
+
 static void FxReset (struct FxInfo_s *);
 static void fx_readRegisterSpace (void);
 static void fx_writeRegisterSpace (void);
 static void fx_updateRamBank (uint8);
 static void fx_dirtySCBR (void);
 static bool8 fx_checkStartAddress (void);
+static bool8 FxStart (void);
 static uint32 FxEmulate (uint32);
+static bool8 FxCanRunAhead (void);
+static void FxRunAhead (uint32);
+static void FxThreadMain (void);
 static void FxCacheWriteAccess (uint16);
 static void FxFlushCache (void);
 
@@ -199,6 +231,21 @@ void S9xInitSuperFX (void)
 
 void S9xResetSuperFX (void)
 {
+	S9xSuperFXSync();
+
+	for (int b = 0, i = 0; b < 0x100; b++)
+	{
+		if (b == 0x70 || b == 0x71)
+			for (int c = 0; c < 16; c++)
+				FxRAMBlock[i++] = (b << 4) | c;
+		else
+		if (!(b & 0x40))
+		{
+			FxRAMBlock[i++] = (b << 4) | 6;
+			FxRAMBlock[i++] = (b << 4) | 7;
+		}
+	}
+
 	// FIXME: Snes9x can't execute CPU and SuperFX at a time. Don't ask me what is 0.417 :P
 	SuperFX.speedPerLine = (uint32) (0.417 * 10.5e6 * ((1.0 / (float) Memory.ROMFramesPerSecond) / ((float) (Timings.V_Max))));
 	SuperFX.oneLineDone = FALSE;
@@ -209,6 +256,8 @@ void S9xResetSuperFX (void)
 
 void S9xSetSuperFX (uint8 byte, uint16 address)
 {
+	S9xSuperFXSync();
+
 	switch (address)
 	{
 		case 0x3030:
@@ -300,6 +349,8 @@ uint8 S9xGetSuperFX (uint16 address)
 {
 	uint8	byte;
 
+	S9xSuperFXSync();
+
 	byte = Memory.FillRAM[address];
 
 	if (address == 0x3031)
@@ -313,9 +364,24 @@ uint8 S9xGetSuperFX (uint16 address)
 
 void S9xSuperFXExec (void)
 {
+	S9xSuperFXSync();
+
 	if ((Memory.FillRAM[0x3000 + GSU_SFR] & FLG_G) && (Memory.FillRAM[0x3000 + GSU_SCMR] & 0x18) == 0x18)
 	{
-		FxEmulate((Memory.FillRAM[0x3000 + GSU_CLSR] & 1) ? SuperFX.speedPerLine * 2 : SuperFX.speedPerLine);
+		uint32	nInstructions = (Memory.FillRAM[0x3000 + GSU_CLSR] & 1) ? SuperFX.speedPerLine * 2 : SuperFX.speedPerLine;
+
+		// With its IRQ masked, the GSU can't signal the CPU by the end of the
+		// line, so the CPU only needs its results once it touches the GSU.
+		if (Settings.SuperFXThread && (Memory.FillRAM[0x3000 + GSU_CFGR] & 0x80) && FxCanRunAhead())
+		{
+			if (FxStart())
+			{
+				FxRunAhead(nInstructions);
+				return;
+			}
+		}
+		else
+			FxEmulate(nInstructions);
 
 		uint16 GSUStatus = Memory.FillRAM[0x3000 + GSU_SFR] | (Memory.FillRAM[0x3000 + GSU_SFR + 1] << 8);
 		if ((GSUStatus & (FLG_G | FLG_IRQ)) == FLG_IRQ)
@@ -323,6 +389,130 @@ void S9xSuperFXExec (void)
 	}
 }
 
+// Waits for the line of GSU work running on the thread, if any.
+void S9xSuperFXSync (void)
+{
+	if (!FxRunningAhead)
+		return;
+
+	while (FxThread->Job)
+		std::this_thread::yield();
+
+	for (int i = 0; i < FX_RAM_BLOCKS; i++)
+	{
+		Memory.Map[FxRAMBlock[i]] = FxRAMMap[i];
+		Memory.WriteMap[FxRAMBlock[i]] = FxRAMWriteMap[i];
+	}
+
+	FxRunningAhead = FALSE;
+}
+
+uint8 S9xGetSuperFXRAM (uint32 address)
+{
+	S9xSuperFXSync();
+
+	uint8	*byte = Memory.Map[(address & 0xffffff) >> MEMMAP_SHIFT] + (address & 0xffff);
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+
+	return (*byte);
+}
+
+void S9xSetSuperFXRAM (uint8 byte, uint32 address)
+{
+	S9xSuperFXSync();
+
+	uint8	*ptr = Memory.WriteMap[(address & 0xffffff) >> MEMMAP_SHIFT] + (address & 0xffff);
+#ifdef DEBUGGER
+	GilgameshAccessPointer(ptr, ACCESS_WRITE);
+#endif
+
+	*ptr = byte;
+}
+
+// The thread only pays with a core of its own. Nothing may keep a pointer
+// into Game Pak RAM across the line: not the CPU fetching code there, nor a
+// DMA or HDMA reading it. The debugger's watchpoints must not have
+// redirected the blocks either.
+// Whether base + offset points into Game Pak RAM; base may be NULL.
+static bool8 FxInRAM (const uint8 *base, uint32 offset)
+{
+	return (base != NULL && (size_t) ((pint) (base + offset) - (pint) Memory.SRAM) < 0x20000);
+}
+
+static bool8 FxCanRunAhead (void)
+{
+	if (!FxThreadPays || CPU.InDMAorHDMA || FxInRAM(CPU.PCBase, Registers.PCw))
+		return (FALSE);
+
+	for (int d = 0; d < 8; d++)
+		if (FxInRAM(HDMAMemPointers[d], 0))
+			return (FALSE);
+
+	for (int i = 0; i < FX_RAM_BLOCKS; i++)
+	{
+		FxRAMMap[i] = Memory.Map[FxRAMBlock[i]];
+		FxRAMWriteMap[i] = Memory.WriteMap[FxRAMBlock[i]];
+		if (FxRAMMap[i] < (uint8 *) CMemory::MAP_LAST || FxRAMWriteMap[i] < (uint8 *) CMemory::MAP_LAST)
+			return (FALSE);
+	}
+
+	return (TRUE);
+}
+
+static void FxRunAhead (uint32 nInstructions)
+{
+	if (!FxThread)
+	{
+		FxThread = new FxThread_s;
+		FxThread->Job = 0;
+		FxThread->Sleeping = false;
+		std::thread(FxThreadMain).detach();
+	}
+
+	for (int i = 0; i < FX_RAM_BLOCKS; i++)
+		Memory.Map[FxRAMBlock[i]] = Memory.WriteMap[FxRAMBlock[i]] = (uint8 *) CMemory::MAP_SUPERFX_RAM;
+
+	FxRunningAhead = TRUE;
+	FxThread->Job = nInstructions;
+
+	if (FxThread->Sleeping)
+	{
+		std::lock_guard<std::mutex>	lock(FxThread->Mutex);
+		FxThread->Wake.notify_one();
+	}
+}
+
+// Spins between lines while the GSU is busy, and sleeps once it has stopped.
+static void FxThreadMain (void)
+{
+	for (;;)
+	{
+		uint32	nInstructions;
+
+		for (int spin = 0; !(nInstructions = FxThread->Job); spin++)
+		{
+			if (spin < 0x1000)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex>	lock(FxThread->Mutex);
+			FxThread->Sleeping = true;
+			FxThread->Wake.wait(lock, [] { return (FxThread->Job != 0); });
+			FxThread->Sleeping = false;
+			spin = 0;
+		}
+
+		fx_run(nInstructions);
+		fx_writeRegisterSpace();
+
+		FxThread->Job = 0;
+	}
+}
+
 static void FxReset (struct FxInfo_s *psFxInfo)
 {
 	// Clear all internal variables
@@ -544,12 +734,9 @@ static bool8 fx_checkStartAddress (void)
 	return (TRUE);
 }
 
-// Execute until the next stop instruction
-static uint32 FxEmulate (uint32 nInstructions)
+// Read registers and initialize GSU session
+static bool8 FxStart (void)
 {
-	uint32	vCount;
-
-	// Read registers and initialize GSU session
 	fx_readRegisterSpace();
 
 	// Check if the start address is valid
@@ -562,12 +749,23 @@ static uint32 FxEmulate (uint32 nInstructions)
 		return (FX_ERROR_ILLEGAL_ADDRESS);
 		*/
 
-		return (0);
+		return (FALSE);
 	}
 
-	// Execute GSU session
 	CF(IRQ);
 
+	return (TRUE);
+}
+
+// Execute until the next stop instruction
+static uint32 FxEmulate (uint32 nInstructions)
+{
+	uint32	vCount;
+
+	if (!FxStart())
+		return (0);
+
+	// Execute GSU session
 	/*
 	if (GSU.bBreakPoint)
 		vCount = fx_run_to_breakpoint(nInstructions);
@@ -202,6 +202,9 @@ void S9xResetSuperFX (void);
 void S9xSuperFXExec (void);
 void S9xSetSuperFX (uint8, uint16);
 uint8 S9xGetSuperFX (uint16);
+void S9xSuperFXSync (void);
+uint8 S9xGetSuperFXRAM (uint32);
+void S9xSetSuperFXRAM (uint8, uint32);
 void fx_flushCache (void);
 void fx_computeScreenPointers (void);
 uint32 fx_run (uint32);
@@ -187,15 +187,22 @@
 #include "obc1.h"
 #include "seta.h"
 #include "bsx.h"
+#include "fxemu.h"
+#ifdef DEBUGGER
+#include "gilgamesh.h"
+#endif
 
 #define addCyclesInMemoryAccess \
 	if (!CPU.InDMAorHDMA) \
 	{ \
 		CPU.PrevCycles = CPU.Cycles; \
 		CPU.Cycles += speed; \
-		S9xCheckInterrupts(); \
-		while (CPU.Cycles >= CPU.NextEvent) \
-			S9xDoHEventProcessing(); \
+		if (CPU.Cycles >= CPU.NextCheck) \
+		{ \
+			S9xCheckInterrupts(); \
+			while (CPU.Cycles >= CPU.NextEvent) \
+				S9xDoHEventProcessing(); \
+		} \
 	}
 
 #define addCyclesInMemoryAccess_x2 \
@@ -203,13 +210,39 @@
 	{ \
 		CPU.PrevCycles = CPU.Cycles; \
 		CPU.Cycles += speed << 1; \
-		S9xCheckInterrupts(); \
-		while (CPU.Cycles >= CPU.NextEvent) \
-			S9xDoHEventProcessing(); \
+		if (CPU.Cycles >= CPU.NextCheck) \
+		{ \
+			S9xCheckInterrupts(); \
+			while (CPU.Cycles >= CPU.NextEvent) \
+				S9xDoHEventProcessing(); \
+		} \
 	}
 
 extern uint8	OpenBus;
 
+#ifdef DEBUGGER
+// Accessors of the blocks the debugger redirected to MAP_WATCH (debug.cpp).
+uint8 * S9xWatchMap (uint32);
+uint8 S9xWatchGetByte (uint32);
+uint16 S9xWatchGetWord (uint32, enum s9xwrap_t);
+void S9xWatchSetByte (uint8, uint32);
+void S9xWatchSetWord (uint16, uint32, enum s9xwrap_t, enum s9xwriteorder_t);
+// To call after rewriting entries of Memory.Map or Memory.WriteMap.
+void S9xWatchMapChanged (void);
+#endif
+
+#ifdef DEBUGGER
+// Feeds Gilgamesh's shadow memory, if the byte is in WRAM or SRAM.
+static inline void GilgameshAccessPointer (const uint8 *byte, uint8 kind)
+{
+	if ((size_t) (byte - Memory.RAM) < 0x20000)
+		GilgameshAccess(MEMORY_WRAM, byte - Memory.RAM, kind, CPU.InDMAorHDMA);
+	else
+	if ((size_t) (byte - Memory.SRAM) < 0x20000)
+		GilgameshAccess(MEMORY_SRAM, byte - Memory.SRAM, kind, CPU.InDMAorHDMA);
+}
+#endif
+
 static inline int32 memory_speed (uint32 address)
 {
 	if (address & 0x408000)
@@ -229,107 +262,49 @@ static inline int32 memory_speed (uint32 address)
 	return (TWO_CYCLES);
 }
 
+// Access speed of a block, from the table built by CMemory::map_Speed().
+// The block at $4000 in the system banks is the only one with two speeds
+// ($4000-$41ff is slower), so its entry is 0.
+static inline int32 block_speed (int block, uint32 address)
+{
+	int32	speed = Memory.BlockSpeed[block];
+
+	if (!speed)
+		return (memory_speed(address));
+
+	return (speed);
+}
+
+// Byte accessors of the blocks that aren't plain memory, by map type
+// (memmap.cpp). They don't add the access cycles: their callers do.
+extern uint8 (* const S9xGetByteHandlers[CMemory::MAP_LAST]) (uint32);
+extern void (* const S9xSetByteHandlers[CMemory::MAP_LAST]) (uint8, uint32);
+
 inline uint8 S9xGetByte (uint32 Address)
 {
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*GetAddress = Memory.Map[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = block_speed(block, Address);
 	uint8	byte;
 
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		byte = *(GetAddress + (Address & 0xffff));
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(GetAddress + (Address & 0xffff), ACCESS_READ);
+	#endif
 		addCyclesInMemoryAccess;
 		return (byte);
 	}
 
-	switch ((pint) GetAddress)
-	{
-		case CMemory::MAP_CPU:
-			byte = S9xGetCPU(Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_PPU:
-			if (CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
-				return (OpenBus);
-
-			byte = S9xGetPPU(Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_LOROM_SRAM:
-		case CMemory::MAP_SA1RAM:
-			// Address & 0x7fff   : offset into bank
-			// Address & 0xff0000 : bank
-			// bank >> 1 | offset : SRAM address, unbound
-			// unbound & SRAMMask : SRAM offset
-			byte = *(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask));
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_LOROM_SRAM_B:
-			byte = *(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB));
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_HIROM_SRAM:
-		case CMemory::MAP_RONLY_SRAM:
-			byte = *(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask));
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_BWRAM:
-			byte = *(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_DSP:
-			byte = S9xGetDSP(Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_SPC7110_ROM:
-			byte = S9xGetSPC7110Byte(Address);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_SPC7110_DRAM:
-			byte = S9xGetSPC7110(0x4800);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_C4:
-			byte = S9xGetC4(Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_OBC_RAM:
-			byte = S9xGetOBC1(Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_SETA_DSP:
-			byte = S9xGetSetaDSP(Address);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_SETA_RISC:
-			byte = S9xGetST018(Address);
-			addCyclesInMemoryAccess;
-			return (byte);
-
-		case CMemory::MAP_BSX:
-			byte = S9xGetBSX(Address);
-			addCyclesInMemoryAccess;
-			return (byte);
+#ifdef DEBUGGER
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		return (S9xWatchGetByte(Address));
+#endif
 
-		case CMemory::MAP_NONE:
-		default:
-			byte = OpenBus;
-			addCyclesInMemoryAccess;
-			return (byte);
-	}
+	byte = S9xGetByteHandlers[(pint) GetAddress](Address);
+	addCyclesInMemoryAccess;
+	return (byte);
 }
 
 inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
@@ -361,12 +336,16 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*GetAddress = Memory.Map[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = block_speed(block, Address);
 	uint16	word;
 
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		word = READ_WORD(GetAddress + (Address & 0xffff));
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(GetAddress + (Address & 0xffff), ACCESS_READ);
+		GilgameshAccessPointer(GetAddress + (Address & 0xffff) + 1, ACCESS_READ);
+	#endif
 		addCyclesInMemoryAccess_x2;
 		return (word);
 	}
@@ -400,6 +379,10 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			else
 				word = (*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask))) |
 					  ((*(Memory.SRAM + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Memory.SRAMMask))) << 8);
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask), ACCESS_READ);
+			GilgameshAccessPointer(Memory.SRAM + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Memory.SRAMMask), ACCESS_READ);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return (word);
 
@@ -409,6 +392,10 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			else
 				word = (*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB))) |
 					  ((*(Multi.sramB + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Multi.sramMaskB))) << 8);
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB), ACCESS_READ);
+			GilgameshAccessPointer(Multi.sramB + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Multi.sramMaskB), ACCESS_READ);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return (word);
 
@@ -419,11 +406,19 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			else
 				word = (*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)) |
 					   (*(Memory.SRAM + ((((Address + 1) & 0x7fff) - 0x6000 + (((Address + 1) & 0xf0000) >> 3)) & Memory.SRAMMask)) << 8));
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask), ACCESS_READ);
+			GilgameshAccessPointer(Memory.SRAM + ((((Address + 1) & 0x7fff) - 0x6000 + (((Address + 1) & 0xf0000) >> 3)) & Memory.SRAMMask), ACCESS_READ);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return (word);
 
 		case CMemory::MAP_BWRAM:
 			word = READ_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000));
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), ACCESS_READ);
+			GilgameshAccessPointer(Memory.BWRAM + ((Address & 0x7fff) - 0x6000) + 1, ACCESS_READ);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return (word);
 
@@ -483,6 +478,22 @@ inline uint16 S9xGetWord (uint32 Address, enum s9xwrap_t w = WRAP_NONE)
 			addCyclesInMemoryAccess;
 			return (word);
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			return (S9xGetWord(Address, w));
+
+		case CMemory::MAP_SA1_SHARED:
+			word  = S9xGetSA1Shared(Address);
+			addCyclesInMemoryAccess;
+			word |= S9xGetSA1Shared(Address + 1) << 8;
+			addCyclesInMemoryAccess;
+			return (word);
+
+	#ifdef DEBUGGER
+		case CMemory::MAP_WATCH:
+			return (S9xWatchGetWord(Address, w));
+	#endif
+
 		case CMemory::MAP_NONE:
 		default:
 			word = OpenBus | (OpenBus << 8);
@@ -495,106 +506,28 @@ inline void S9xSetByte (uint8 Byte, uint32 Address)
 {
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*SetAddress = Memory.WriteMap[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = block_speed(block, Address);
 
 	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		*(SetAddress + (Address & 0xffff)) = Byte;
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(SetAddress + (Address & 0xffff), ACCESS_WRITE);
+	#endif
 		addCyclesInMemoryAccess;
 		return;
 	}
 
-	switch ((pint) SetAddress)
+#ifdef DEBUGGER
+	if (SetAddress == (uint8 *) CMemory::MAP_WATCH)
 	{
-		case CMemory::MAP_CPU:
-			S9xSetCPU(Byte, Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_PPU:
-			if (CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
-				return;
-
-			S9xSetPPU(Byte, Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_LOROM_SRAM:
-			if (Memory.SRAMMask)
-			{
-				*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)) = Byte;
-				CPU.SRAMModified = TRUE;
-			}
-
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_LOROM_SRAM_B:
-			if (Multi.sramMaskB)
-			{
-				*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)) = Byte;
-				CPU.SRAMModified = TRUE;
-			}
-
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_HIROM_SRAM:
-			if (Memory.SRAMMask)
-			{
-				*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)) = Byte;
-				CPU.SRAMModified = TRUE;
-			}
-
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_BWRAM:
-			*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = Byte;
-			CPU.SRAMModified = TRUE;
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_SA1RAM:
-			*(Memory.SRAM + (Address & 0xffff)) = Byte;
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_DSP:
-			S9xSetDSP(Byte, Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_C4:
-			S9xSetC4(Byte, Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_OBC_RAM:
-			S9xSetOBC1(Byte, Address & 0xffff);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_SETA_DSP:
-			S9xSetSetaDSP(Byte, Address);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_SETA_RISC:
-			S9xSetST018(Byte, Address);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_BSX:
-			S9xSetBSX(Byte, Address);
-			addCyclesInMemoryAccess;
-			return;
-
-		case CMemory::MAP_NONE:
-		default:
-			addCyclesInMemoryAccess;
-			return;
+		S9xWatchSetByte(Byte, Address);
+		return;
 	}
+#endif
+
+	S9xSetByteHandlers[(pint) SetAddress](Byte, Address);
+	addCyclesInMemoryAccess;
 }
 
 inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NONE, enum s9xwriteorder_t o = WRITE_01)
@@ -635,11 +568,15 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 
 	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
 	uint8	*SetAddress = Memory.WriteMap[block];
-	int32	speed = memory_speed(Address);
+	int32	speed = block_speed(block, Address);
 
 	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		WRITE_WORD(SetAddress + (Address & 0xffff), Word);
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(SetAddress + (Address & 0xffff), ACCESS_WRITE);
+		GilgameshAccessPointer(SetAddress + (Address & 0xffff) + 1, ACCESS_WRITE);
+	#endif
 		addCyclesInMemoryAccess_x2;
 		return;
 	}
@@ -703,6 +640,10 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 				}
 
 				CPU.SRAMModified = TRUE;
+			#ifdef DEBUGGER
+				GilgameshAccessPointer(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask), ACCESS_WRITE);
+				GilgameshAccessPointer(Memory.SRAM + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Memory.SRAMMask), ACCESS_WRITE);
+			#endif
 			}
 
 			addCyclesInMemoryAccess_x2;
@@ -720,6 +661,10 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 				}
 
 				CPU.SRAMModified = TRUE;
+			#ifdef DEBUGGER
+				GilgameshAccessPointer(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB), ACCESS_WRITE);
+				GilgameshAccessPointer(Multi.sramB + (((((Address + 1) & 0xff0000) >> 1) | ((Address + 1) & 0x7fff)) & Multi.sramMaskB), ACCESS_WRITE);
+			#endif
 			}
 
 			addCyclesInMemoryAccess_x2;
@@ -737,6 +682,10 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 				}
 
 				CPU.SRAMModified = TRUE;
+			#ifdef DEBUGGER
+				GilgameshAccessPointer(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask), ACCESS_WRITE);
+				GilgameshAccessPointer(Memory.SRAM + ((((Address + 1) & 0x7fff) - 0x6000 + (((Address + 1) & 0xf0000) >> 3)) & Memory.SRAMMask), ACCESS_WRITE);
+			#endif
 			}
 
 			addCyclesInMemoryAccess_x2;
@@ -745,11 +694,19 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 		case CMemory::MAP_BWRAM:
 			WRITE_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), Word);
 			CPU.SRAMModified = TRUE;
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), ACCESS_WRITE);
+			GilgameshAccessPointer(Memory.BWRAM + ((Address & 0x7fff) - 0x6000) + 1, ACCESS_WRITE);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return;
 
 		case CMemory::MAP_SA1RAM:
 			WRITE_WORD(Memory.SRAM + (Address & 0xffff), Word);
+		#ifdef DEBUGGER
+			GilgameshAccessPointer(Memory.SRAM + (Address & 0xffff), ACCESS_WRITE);
+			GilgameshAccessPointer(Memory.SRAM + (Address & 0xffff) + 1, ACCESS_WRITE);
+		#endif
 			addCyclesInMemoryAccess_x2;
 			return;
 
@@ -861,6 +818,35 @@ inline void S9xSetWord (uint16 Word, uint32 Address, enum s9xwrap_t w = WRAP_NON
 				return;
 			}
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			S9xSetWord(Word, Address, w, o);
+			return;
+
+		case CMemory::MAP_SA1_SHARED:
+			if (o)
+			{
+				S9xSetSA1Shared(Word >> 8, Address + 1);
+				addCyclesInMemoryAccess;
+				S9xSetSA1Shared((uint8) Word, Address);
+				addCyclesInMemoryAccess;
+				return;
+			}
+			else
+			{
+				S9xSetSA1Shared((uint8) Word, Address);
+				addCyclesInMemoryAccess;
+				S9xSetSA1Shared(Word >> 8, Address + 1);
+				addCyclesInMemoryAccess;
+				return;
+			}
+
+	#ifdef DEBUGGER
+		case CMemory::MAP_WATCH:
+			S9xWatchSetWord(Word, Address, w, o);
+			return;
+	#endif
+
 		case CMemory::MAP_NONE:
 		default:
 			addCyclesInMemoryAccess_x2;
@@ -876,7 +862,12 @@ inline void S9xSetPCBase (uint32 Address)
 	int		block;
 	uint8	*GetAddress = Memory.Map[block = ((Address & 0xffffff) >> MEMMAP_SHIFT)];
 
-	CPU.MemSpeed = memory_speed(Address);
+#ifdef DEBUGGER
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		GetAddress = S9xWatchMap(Address);
+#endif
+
+	CPU.MemSpeed = block_speed(block, Address);
 	CPU.MemSpeedx2 = CPU.MemSpeed << 1;
 
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
@@ -932,6 +923,16 @@ inline void S9xSetPCBase (uint32 Address)
 			CPU.PCBase = S9xGetBasePointerBSX(Address);
 			return;
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			S9xSetPCBase(Address);
+			return;
+
+		case CMemory::MAP_SA1_SHARED:
+			// fetch code byte by byte, so that the SA-1 is caught up first
+			CPU.PCBase = NULL;
+			return;
+
 		case CMemory::MAP_NONE:
 		default:
 			CPU.PCBase = NULL;
@@ -943,6 +944,11 @@ inline uint8 * S9xGetBasePointer (uint32 Address)
 {
 	uint8	*GetAddress = Memory.Map[(Address & 0xffffff) >> MEMMAP_SHIFT];
 
+#ifdef DEBUGGER
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		GetAddress = S9xWatchMap(Address);
+#endif
+
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 		return (GetAddress);
 
@@ -978,6 +984,19 @@ inline uint8 * S9xGetBasePointer (uint32 Address)
 		case CMemory::MAP_OBC_RAM:
 			return (S9xGetBasePointerOBC1(Address & 0xffff));
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			return (S9xGetBasePointer(Address));
+
+		case CMemory::MAP_SA1_SHARED:
+		{
+			uint8	*map = S9xSA1SharedMap(Address);
+
+			if (map == (uint8 *) CMemory::MAP_BWRAM)
+				return (Memory.BWRAM - 0x6000 - (Address & 0x8000));
+			return (map < (uint8 *) CMemory::MAP_LAST ? NULL : map);
+		}
+
 		case CMemory::MAP_NONE:
 		default:
 			return (NULL);
@@ -988,6 +1007,11 @@ inline uint8 * S9xGetMemPointer (uint32 Address)
 {
 	uint8	*GetAddress = Memory.Map[(Address & 0xffffff) >> MEMMAP_SHIFT];
 
+#ifdef DEBUGGER
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		GetAddress = S9xWatchMap(Address);
+#endif
+
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 		return (GetAddress + (Address & 0xffff));
 
@@ -1023,6 +1047,19 @@ inline uint8 * S9xGetMemPointer (uint32 Address)
 		case CMemory::MAP_OBC_RAM:
 			return (S9xGetMemPointerOBC1(Address & 0xffff));
 
+		case CMemory::MAP_SUPERFX_RAM:
+			S9xSuperFXSync();
+			return (S9xGetMemPointer(Address));
+
+		case CMemory::MAP_SA1_SHARED:
+		{
+			uint8	*map = S9xSA1SharedMap(Address);
+
+			if (map == (uint8 *) CMemory::MAP_BWRAM)
+				return (Memory.BWRAM - 0x6000 + (Address & 0x7fff));
+			return (map < (uint8 *) CMemory::MAP_LAST ? NULL : map + (Address & 0xffff));
+		}
+
 		case CMemory::MAP_NONE:
 		default:
 			return (NULL);
@@ -186,6 +186,9 @@
 #include "screenshot.h"
 #include "font.h"
 #include "display.h"
+#ifdef DEBUGGER
+#include "gilgamesh.h"
+#endif
 
 extern struct SCheatData		Cheat;
 extern struct SLineData			LineData[240];
@@ -456,6 +459,8 @@ void S9xEndScreenRefresh (void)
 			CPU.Flags |= DEBUG_MODE_FLAG;
 		}
 	}
+
+	GilgameshFrame();
 #endif
 
 	if (CPU.SRAMModified)
@@ -1,15 +1,35 @@
 #ifdef DEBUGGER
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
 #include <sqlite3.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include "snes9x.h"
+#include "memmap.h"
 #include "display.h"
 #include "debug.h"
+#include "movie.h"
+#include "snapshot.h"
 #include "gilgamesh.h"
+#include "gilgamesh_columns.h"
+#include "gilgamesh_exec.h"
 
-#define SQL(...) \
-    do { if (SQLExec(__VA_ARGS__) != SQLITE_OK) return; } while (0)
+#define SQL(Statement) \
+    do { if (SQLExec(Statement) != SQLITE_OK) return false; } while (0)
 
 static const int UNDEFINED = -1;
 enum { DIRECT_REFERENCE = 0, INDIRECT_REFERENCE = 1 };
@@ -18,25 +38,394 @@ static sqlite3* Database;
 static uint32 DMALastPC;
 extern int AddrModes[256];
 
-template<typename... TArgs> int SQLExec(const char* Format, TArgs... Args)
+static int SQLExec(const char* Statement)
 {
     int Status;
     char* Error;
 
-    static char S[4096];
-    sprintf(S, Format, Args...);
-
-    Status = sqlite3_exec(Database, S, NULL, NULL, &Error);
+    Status = sqlite3_exec(Database, Statement, NULL, NULL, &Error);
     if (Status != SQLITE_OK)
     {
         fprintf(stderr, "SQL error: %s\n", Error);
         sqlite3_free(Error);
-        sqlite3_close(Database);
+        sqlite3_close_v2(Database);
+        Database = NULL;
     }
 
     return Status;
 }
 
+/* Prepared INSERT, compiled once and re-bound for every row. */
+struct SStatement
+{
+    sqlite3_stmt* Handle = NULL;
+
+    ~SStatement()
+    {
+        sqlite3_finalize(Handle);
+    }
+
+    bool Prepare(const char* Statement)
+    {
+        if (sqlite3_prepare_v2(Database, Statement, -1, &Handle, NULL) == SQLITE_OK)
+            return true;
+        return Fail();
+    }
+
+    void Bind(int Index, sqlite3_int64 Value)
+    {
+        sqlite3_bind_int64(Handle, Index, Value);
+    }
+
+    void BindNull(int Index)
+    {
+        sqlite3_bind_null(Handle, Index);
+    }
+
+    bool Step()
+    {
+        int Status = sqlite3_step(Handle);
+        sqlite3_reset(Handle);
+        if (Status == SQLITE_DONE)
+            return true;
+        return Fail();
+    }
+
+    template<typename... TArgs> bool Insert(TArgs... Args)
+    {
+        int Index = 1;
+        for (sqlite3_int64 Value: {(sqlite3_int64) Args...})
+            Bind(Index++, Value);
+        return Step();
+    }
+
+private:
+    bool Fail()
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(Database));
+        sqlite3_close_v2(Database);
+        Database = NULL;
+        return false;
+    }
+};
+
+/* Registers (and memory) each addressing mode reads while decoding.
+ * An instruction whose inputs haven't changed since its last decode
+ * would produce exactly the same result, so the decode can be skipped. */
+enum
+{
+    INPUT_M      = 1 << 0,
+    INPUT_X      = 1 << 1,
+    INPUT_D      = 1 << 2,
+    INPUT_DB     = 1 << 3,
+    INPUT_XREG   = 1 << 4,
+    INPUT_YREG   = 1 << 5,
+    INPUT_MEMORY = 1 << 6
+};
+
+static const uint8 DecodeInputs[28] =
+{
+    0,                      // Implied
+    INPUT_M,                // Immediate[MemoryFlag]
+    INPUT_X,                // Immediate[IndexFlag]
+    0,                      // Immediate
+    0,                      // Relative
+    0,                      // Relative Long
+    INPUT_D,                // Direct Page
+    INPUT_D | INPUT_XREG,   // Direct Page Indexed (X)
+    INPUT_D | INPUT_YREG,   // Direct Page Indexed (Y)
+    INPUT_MEMORY,           // Direct Page Indirect
+    INPUT_MEMORY,           // Direct Page Indexed Indirect
+    INPUT_MEMORY,           // Direct Page Indirect Indexed
+    INPUT_MEMORY,           // Direct Page Indirect Long
+    INPUT_MEMORY,           // Direct Page Indirect Indexed Long
+    INPUT_DB,               // Absolute
+    INPUT_DB | INPUT_XREG,  // Absolute Indexed (X)
+    INPUT_DB | INPUT_YREG,  // Absolute Indexed (Y)
+    0,                      // Absolute Long
+    INPUT_XREG,             // Absolute Indexed Long
+    0,                      // Stack Relative
+    INPUT_MEMORY,           // Stack Relative Indirect Indexed
+    INPUT_MEMORY,           // Absolute Indirect
+    INPUT_MEMORY,           // Absolute Indirect Long
+    INPUT_MEMORY,           // Absolute Indexed Indirect
+    0,                      // Implied Accumulator
+    0,                      // MVN/MVP
+    0,                      // PEA
+    INPUT_D                 // PEI
+};
+
+// SPC700 addressing modes, numbered the same way as AddrModes.
+static const uint8 SPC700AddrModes[256] =
+{
+  // 0   1   2   3   4   5   6   7   8   9   A   B   C   D   E   F
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  0,  5,  0, // 0
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  5, 18, // 1
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  0, 11, 10, // 2
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  2,  5, // 3
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  0,  5, 20, // 4
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  5,  5, // 5
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  0, 11,  0, // 6
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  2,  0, // 7
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  1,  0, 14, // 8
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  0,  0, // 9
+     0, 19,  2, 11,  2,  5, 16,  8,  1, 13, 15,  2,  5,  1,  0, 16, // A
+    10, 19,  2, 11,  3,  6,  7,  9, 14, 17,  2,  3,  0,  0,  0, 16, // B
+     0, 19,  2, 11,  2,  5, 16,  8,  1,  5, 15,  2,  5,  1,  0,  0, // C
+    10, 19,  2, 11,  3,  6,  7,  9,  2,  4,  2,  3,  0,  0, 12,  0, // D
+     0, 19,  2, 11,  2,  5, 16,  8,  1,  5, 15,  2,  5,  0,  0,  0, // E
+    10, 19,  2, 11,  3,  6,  7,  9,  2,  4, 13,  3,  0,  0, 10,  0  // F
+};
+
+static const uint8 SPC700DecodeInputs[21] =
+{
+    0,                      // Implied
+    0,                      // Immediate
+    INPUT_D,                // Direct Page
+    INPUT_D | INPUT_XREG,   // Direct Page Indexed (X)
+    INPUT_D | INPUT_YREG,   // Direct Page Indexed (Y)
+    0,                      // Absolute
+    INPUT_XREG,             // Absolute Indexed (X)
+    INPUT_YREG,             // Absolute Indexed (Y)
+    INPUT_MEMORY,           // Direct Page Indexed Indirect
+    INPUT_MEMORY,           // Direct Page Indirect Indexed
+    0,                      // Relative
+    INPUT_D,                // Direct Page, Relative
+    INPUT_D | INPUT_XREG,   // Direct Page Indexed (X), Relative
+    INPUT_D,                // Direct Page, Direct Page
+    INPUT_D,                // Direct Page, Immediate
+    0,                      // Absolute Bit
+    INPUT_D | INPUT_XREG,   // Indirect (X)
+    INPUT_D | INPUT_XREG | INPUT_YREG,  // Indirect (X), Indirect (Y)
+    INPUT_MEMORY,           // Absolute Indexed Indirect
+    INPUT_MEMORY,           // TCALL
+    0                       // PCALL
+};
+
+static const uint8 SPC700Lengths[21] = { 1, 2, 2, 2, 2, 3, 3, 3, 2, 2, 2, 3, 3, 3, 3, 3, 1, 1, 3, 1, 2 };
+
+/* Spilled reference sets live in open-addressing tables carved out of a
+ * single arena. Freed tables are recycled by size. */
+static std::vector<int> ReferenceArena;
+static std::vector<uint32> FreeReferenceTables[32];
+
+static uint32 AllocateReferenceTable(int Log2Capacity)
+{
+    std::vector<uint32>& FreeList = FreeReferenceTables[Log2Capacity];
+    uint32 Offset;
+
+    if (!FreeList.empty())
+    {
+        Offset = FreeList.back();
+        FreeList.pop_back();
+        std::fill_n(ReferenceArena.begin() + Offset, 1 << Log2Capacity, UNDEFINED);
+    }
+    else
+    {
+        Offset = ReferenceArena.size();
+        ReferenceArena.resize(Offset + (1 << Log2Capacity), UNDEFINED);
+    }
+
+    return Offset;
+}
+
+/* Set of referenced addresses. The first few references are stored inline,
+ * since most instructions only ever reference one or two addresses. */
+struct SReferenceSet
+{
+    static const uint32 INLINE_SIZE = 3;
+
+    int    Inline[INLINE_SIZE];
+    uint32 Count = 0;
+    uint32 Table = 0;           // Offset into ReferenceArena, once spilled.
+    uint8  Log2Capacity = 0;    // 0 while not spilled.
+
+    // Returns whether the reference wasn't already in the set.
+    bool Insert(int Reference)
+    {
+        if (Log2Capacity == 0)
+        {
+            for (uint32 i = 0; i < Count; i++)
+                if (Inline[i] == Reference)
+                    return false;
+
+            if (Count < INLINE_SIZE)
+            {
+                Inline[Count++] = Reference;
+                return true;
+            }
+
+            Rehash(3);
+        }
+        else if ((Count + 1) * 4 > (3u << Log2Capacity))
+            Rehash(Log2Capacity + 1);
+
+        if (!TableInsert(Reference))
+            return false;
+        Count++;
+        return true;
+    }
+
+    template<typename F> void ForEach(F Function) const
+    {
+        if (Log2Capacity == 0)
+        {
+            for (uint32 i = 0; i < Count; i++)
+                Function(Inline[i]);
+            return;
+        }
+
+        const int* Slots = &ReferenceArena[Table];
+        for (uint32 i = 0; i < (1u << Log2Capacity); i++)
+            if (Slots[i] != UNDEFINED)
+                Function(Slots[i]);
+    }
+
+private:
+    bool TableInsert(int Reference)
+    {
+        uint32 Mask = (1 << Log2Capacity) - 1;
+        uint32 i = ((uint32) Reference * 0x9E3779B1) >> (32 - Log2Capacity);
+        int* Slots = &ReferenceArena[Table];
+
+        while (Slots[i] != UNDEFINED)
+        {
+            if (Slots[i] == Reference)
+                return false;
+            i = (i + 1) & Mask;
+        }
+
+        Slots[i] = Reference;
+        return true;
+    }
+
+    void Rehash(uint8 NewLog2Capacity)
+    {
+        // Allocating may move the arena, so collect the old contents first.
+        int Old[INLINE_SIZE] = {};
+        std::vector<int> Spilled;
+
+        if (Log2Capacity == 0)
+            std::copy(Inline, Inline + Count, Old);
+        else
+        {
+            ForEach([&](int Reference) { Spilled.push_back(Reference); });
+            FreeReferenceTables[Log2Capacity].push_back(Table);
+        }
+
+        bool WasInline = Log2Capacity == 0;
+        Table = AllocateReferenceTable(NewLog2Capacity);
+        Log2Capacity = NewLog2Capacity;
+
+        if (WasInline)
+            for (uint32 i = 0; i < Count; i++)
+                TableInsert(Old[i]);
+        else
+            for (int Reference: Spilled)
+                TableInsert(Reference);
+    }
+};
+
+/* Trace events are produced by the emulation thread and consumed by the
+ * aggregator thread. They capture everything decoding needs, so that the
+ * emulation thread never has to wait for the decode itself. */
+enum EventType
+{
+    EVENT_INSTRUCTION = 0,
+    EVENT_VECTOR = 1,
+    EVENT_DMA = 2,
+    EVENT_CHECKPOINT = 3,
+    EVENT_SA1_INSTRUCTION = 4,
+    EVENT_SPC700_INSTRUCTION = 5,
+    EVENT_FRAME = 6
+};
+
+/* Also used for the SA-1, and for the SPC700: there P only holds the
+ * direct page flag, and D is the direct page itself. */
+struct SInstructionEvent
+{
+    uint32 PC;
+    uint8  P;
+    uint8  DB;
+    uint16 D;
+    uint16 X;
+    uint16 Y;
+    uint16 A;               // Only for the execution log.
+    uint16 S;
+    union
+    {
+        uint8  Bytes[4];    // Opcode and operands.
+        uint32 Code;
+    };
+    uint8  Pointer[3];      // Memory read through the operand (indirect modes only).
+    bool   AfterGap;        // Whether instructions were filtered out since the previous trace.
+    uint32 PrevCount;       // Profile of the instructions dispatched since the
+    uint32 PrevCycles;      // previous trace (normally just the previous one).
+    uint64 GapCycles;       // Cycles of the instructions and frames filtered out after that.
+};
+
+struct SVectorEvent
+{
+    uint32        PC;
+    VectorType    Type;
+    ProcessorType Processor;
+    bool          Dispatched;   // Whether the last traced instruction ran before it.
+};
+
+struct SDMAEvent
+{
+    uint32             Source;
+    uint16             Bytes;
+    DMADestinationType Destination;
+};
+
+// Starts a frame: the execution log numbers its blocks with it.
+struct SFrameEvent
+{
+    uint32 Frame;
+    bool   ExecLog;         // Whether to log this frame.
+};
+
+struct SShadowPage;
+
+struct SCheckpointEvent
+{
+    bool Close;             // Close the database once written.
+    std::vector<SShadowPage>* Memory;
+};
+
+struct STraceEvent
+{
+    EventType Type;
+    union
+    {
+        SInstructionEvent Instruction;
+        SVectorEvent      Vector;
+        SDMAEvent         DMA;
+        SFrameEvent       Frame;
+        SCheckpointEvent  Checkpoint;
+    };
+};
+
+/* Rows added or changed since the last checkpoint. Only the aggregator
+ * thread touches these; a checkpoint hands them over to the writer. */
+struct SInstructionRow
+{
+    uint32 PC;
+    uint8  Opcode;
+    uint8  Flags;
+    int    Operand;
+    uint32 Executions;
+    uint64 Cycles;
+};
+
+struct SReferenceRow
+{
+    uint32 Pointer;
+    int    Pointee;
+    uint8  Type;
+};
+
 struct SInstruction
 {
     union
@@ -49,27 +438,66 @@ struct SInstruction
         };
     };
 
-    uint8 Opcode;
-    uint8 Flags;
+    uint8 Opcode = 0;
+    uint8 Flags = 0;
 
     int Operand = UNDEFINED;
-    std::unordered_set<int> References;
-    std::unordered_set<int> IndirectReferences;
+    SReferenceSet References;
+    SReferenceSet IndirectReferences;
+    bool Dirty = false;         // Queued for the next checkpoint.
+
+    // Profile since the last checkpoint, and before it (for live queries):
+    uint32 Executions = 0;
+    uint64 Cycles = 0;
+    uint64 CheckpointedExecutions = 0;
+    uint64 CheckpointedCycles = 0;
+
+    // Decode cache:
+    bool   Cached = false;
+    bool   TriggersDMA = false;
+    uint8  Inputs;              // DecodeInputs of the addressing mode.
+    uint8  CachedDB;
+    uint16 CachedD;
+    uint16 CachedX;
+    uint16 CachedY;
+    uint32 CachedCode;
 
     explicit SInstruction(uint32 PC) : PC(PC) {}
 
-    void Decode()
+    /* Check whether decoding the event would give the same result as the
+     * last decode: same code bytes, and same values for the registers the
+     * addressing mode reads. */
+    bool IsCached(const SInstructionEvent& E) const
+    {
+        if (!Cached || CachedCode != E.Code)
+            return false;
+
+        if ((Inputs & INPUT_M) && ((Flags ^ E.P) & MemoryFlag))
+            return false;
+        if ((Inputs & INPUT_X) && ((Flags ^ E.P) & IndexFlag))
+            return false;
+        if ((Inputs & INPUT_D) && CachedD != E.D)
+            return false;
+        if ((Inputs & INPUT_DB) && CachedDB != E.DB)
+            return false;
+        if ((Inputs & INPUT_XREG) && CachedX != E.X)
+            return false;
+        if ((Inputs & INPUT_YREG) && CachedY != E.Y)
+            return false;
+
+        return true;
+    }
+
+    void Decode(const SInstructionEvent& E, std::vector<SReferenceRow>& NewReferences)
     {
         int Reference = UNDEFINED;
         int IndirectReference = UNDEFINED;
-        uint8 Operands[3];
-
-        Opcode      = S9xDebugGetByte(PC);
-        Operands[0] = S9xDebugGetByte(PC + 1);
-        Operands[1] = S9xDebugGetByte(PC + 2);
-        Operands[2] = S9xDebugGetByte(PC + 3);
+        const uint8* Operands = E.Bytes + 1;
+        int Pointer     = (E.Pointer[1] << 8) | E.Pointer[0];
+        int PointerLong = (E.Pointer[2] << 16) | Pointer;
 
-        Flags = Registers.P.B.l;
+        Opcode = E.Bytes[0];
+        Flags  = E.P;
 
         switch (AddrModes[Opcode])
         {
@@ -79,7 +507,7 @@ struct SInstruction
 
             // Immediate[MemoryFlag]:
             case 1:
-                if (!CheckFlag(MemoryFlag))
+                if (!(E.P & MemoryFlag))
                 {
                     // Accumulator 16-bits:
                     Operand = (Operands[1] << 8) | Operands[0];
@@ -93,7 +521,7 @@ struct SInstruction
 
             // Immediate[IndexFlag]:
             case 2:
-                if (!CheckFlag(IndexFlag))
+                if (!(E.P & IndexFlag))
                 {
                     // X/Y 16-bits:
                     Operand = (Operands[1] << 8) | Operands[0];
@@ -125,72 +553,72 @@ struct SInstruction
             // Direct Page:
             case 6:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
+                Reference = Operand + E.D;
                 break;
 
             // Direct Page Indexed (with X):
             case 7:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W + Registers.X.W;
+                Reference = Operand + E.D + E.X;
                 break;
 
             // Direct Page Indexed (with Y):
             case 8:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W + Registers.Y.W;
+                Reference = Operand + E.D + E.Y;
                 break;
 
             // Direct Page Indirect:
             case 9:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
-                IndirectReference = (Registers.DB << 16) | S9xDebugGetWord(Reference);
+                Reference = Operand + E.D;
+                IndirectReference = (E.DB << 16) | Pointer;
                 break;
 
             // Direct Page Indexed Indirect:
             case 10:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W + Registers.X.W;
-                IndirectReference = (Registers.DB << 16) | S9xDebugGetWord(Reference);
+                Reference = Operand + E.D + E.X;
+                IndirectReference = (E.DB << 16) | Pointer;
                 break;
 
             // Direct Page Indirect Indexed:
             case 11:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
-                IndirectReference = (Registers.DB << 16) | ((S9xDebugGetWord(Reference) + Registers.Y.W) & 0xFFFF);
+                Reference = Operand + E.D;
+                IndirectReference = (E.DB << 16) | ((Pointer + E.Y) & 0xFFFF);
                 break;
 
             // Direct Page Indirect Long:
             case 12:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
-                IndirectReference = (S9xDebugGetByte(Reference + 2) << 16) | S9xDebugGetWord(Reference);
+                Reference = Operand + E.D;
+                IndirectReference = PointerLong;
                 break;
 
             // Direct Page Indirect Indexed Long:
             case 13:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
-                IndirectReference = (S9xDebugGetByte(Reference + 2) << 16) | ((S9xDebugGetWord(Reference) + Registers.Y.W) & 0xFFFF);
+                Reference = Operand + E.D;
+                IndirectReference = (E.Pointer[2] << 16) | ((Pointer + E.Y) & 0xFFFF);
                 break;
 
             // Absolute:
             case 14:
                 Operand = (Operands[1] << 8) | Operands[0];
-                Reference = (Registers.DB << 16) | Operand;
+                Reference = (E.DB << 16) | Operand;
                 break;
 
             // Absolute Indexed (with X):
             case 15:
                 Operand = (Operands[1] << 8) | Operands[0];
-                Reference = (Registers.DB << 16) | (Operand + Registers.X.W);
+                Reference = (E.DB << 16) | (Operand + E.X);
                 break;
 
             // Absolute Indexed (with Y):
             case 16:
                 Operand = (Operands[1] << 8) | Operands[0];
-                Reference = (Registers.DB << 16) | (Operand + Registers.Y.W);
+                Reference = (E.DB << 16) | (Operand + E.Y);
                 break;
 
             // Absolute Long:
@@ -202,7 +630,7 @@ struct SInstruction
             // Absolute Indexed Long:
             case 18:
                 Operand = (Operands[2] << 16) | (Operands[1] << 8) | Operands[0];
-                Reference = (Operands[2] << 16) | (((Operands[1] << 8) + Operands[0] + Registers.X.W) & 0xFFFF);
+                Reference = (Operands[2] << 16) | (((Operands[1] << 8) + Operands[0] + E.X) & 0xFFFF);
                 break;
 
             // Stack Relative:
@@ -214,30 +642,29 @@ struct SInstruction
             // Stack Relative Indirect Indexed:
             case 20:
                 Operand = Operands[0];
-                Reference = Operand + Registers.S.W;
-                IndirectReference = (Registers.DB << 16) | ((S9xDebugGetWord(Reference) + Registers.Y.W) & 0xFFFF);
-                Reference = UNDEFINED;  // Don't keep track of stack positions.
+                IndirectReference = (E.DB << 16) | ((Pointer + E.Y) & 0xFFFF);
+                // Don't keep track of stack positions.
                 break;
 
             // Absolute Indirect:
             case 21:
                 Operand = (Operands[1] << 8) | Operands[0];
                 Reference = Operand;
-                IndirectReference = (Registers.PB << 16) | S9xDebugGetWord(Reference);
+                IndirectReference = (Bank << 16) | Pointer;
                 break;
 
             // Absolute Indirect Long:
             case 22:
                 Operand = (Operands[1] << 8) | Operands[0];
                 Reference = Operand;
-                IndirectReference = (S9xDebugGetByte(Reference + 2) << 16) | S9xDebugGetWord(Reference);
+                IndirectReference = PointerLong;
                 break;
 
             // Absolute Indexed Indirect:
             case 23:
                 Operand = (Operands[1] << 8) | Operands[0];
-                Reference = (Registers.PB << 16) | ((Operand + Registers.X.W) & 0xFFFF);
-                IndirectReference = S9xDebugGetWord(Reference);
+                Reference = (Bank << 16) | ((Operand + E.X) & 0xFFFF);
+                IndirectReference = Pointer;
                 break;
 
             // Implied Accumulator:
@@ -259,22 +686,181 @@ struct SInstruction
             // PEI Direct Page Indirect:
             case 27:
                 Operand = Operands[0];
-                Reference = Operand + Registers.D.W;
+                Reference = Operand + E.D;
                 // IndirectReference = S9xDebugGetWord(Reference);
                 // TODO: Should it be counted as a reference?
                 break;
         }
 
-        if (Reference != UNDEFINED) {
-            this->References.insert(Reference);
+        // TODO: technically DMA could also be indirect.
+        TriggersDMA = Reference == 0x420B;
+
+        AddReference(Reference, DIRECT_REFERENCE, NewReferences);
+        AddReference(IndirectReference, INDIRECT_REFERENCE, NewReferences);
+        Cache(E, DecodeInputs[AddrModes[Opcode]]);
+    }
+
+    void DecodeSPC700(const SInstructionEvent& E, std::vector<SReferenceRow>& NewReferences)
+    {
+        int Reference = UNDEFINED;
+        int Reference2 = UNDEFINED;     // Instructions with two operands.
+        int IndirectReference = UNDEFINED;
+        const uint8* Operands = E.Bytes + 1;
+        int Pointer = (E.Pointer[1] << 8) | E.Pointer[0];
+        int Word = (Operands[1] << 8) | Operands[0];
+        uint8 Mode = SPC700AddrModes[E.Bytes[0]];
+
+        Opcode = E.Bytes[0];
+        Flags  = E.P;
+
+        switch (SPC700Lengths[Mode])
+        {
+            case 1:
+                Operand = UNDEFINED;
+                break;
+            case 2:
+                Operand = Operands[0];
+                break;
+            default:
+                Operand = Word;
+                break;
+        }
+
+        switch (Mode)
+        {
+            // Direct Page:
+            case 2:
+                Reference = E.D + Operands[0];
+                break;
+
+            // Direct Page Indexed (with X):
+            case 3:
+                Reference = E.D + ((Operands[0] + E.X) & 0xFF);
+                break;
+
+            // Direct Page Indexed (with Y):
+            case 4:
+                Reference = E.D + ((Operands[0] + E.Y) & 0xFF);
+                break;
+
+            // Absolute:
+            case 5:
+                Reference = Word;
+                break;
+
+            // Absolute Indexed (with X):
+            case 6:
+                Reference = (Word + E.X) & 0xFFFF;
+                break;
+
+            // Absolute Indexed (with Y):
+            case 7:
+                Reference = (Word + E.Y) & 0xFFFF;
+                break;
+
+            // Direct Page Indexed Indirect, [dp+X]:
+            case 8:
+                Reference = E.D + ((Operands[0] + E.X) & 0xFF);
+                IndirectReference = Pointer;
+                break;
+
+            // Direct Page Indirect Indexed, [dp]+Y:
+            case 9:
+                Reference = E.D + Operands[0];
+                IndirectReference = (Pointer + E.Y) & 0xFFFF;
+                break;
+
+            // Relative:
+            case 10:
+                Reference = (Address + 2 + (int8) Operands[0]) & 0xFFFF;
+                break;
+
+            // Direct Page, Relative (BBS, BBC, CBNE, DBNZ):
+            case 11:
+                Reference = E.D + Operands[0];
+                Reference2 = (Address + 3 + (int8) Operands[1]) & 0xFFFF;
+                break;
+
+            // Direct Page Indexed (with X), Relative (CBNE):
+            case 12:
+                Reference = E.D + ((Operands[0] + E.X) & 0xFF);
+                Reference2 = (Address + 3 + (int8) Operands[1]) & 0xFFFF;
+                break;
+
+            // Direct Page, Direct Page (source first):
+            case 13:
+                Reference = E.D + Operands[0];
+                Reference2 = E.D + Operands[1];
+                break;
+
+            // Direct Page, Immediate (immediate first):
+            case 14:
+                Reference = E.D + Operands[1];
+                break;
+
+            // Absolute Bit (13-bit address, 3-bit bit number):
+            case 15:
+                Reference = Word & 0x1FFF;
+                break;
+
+            // Indirect (X), (X)+:
+            case 16:
+                Reference = E.D + E.X;
+                break;
+
+            // Indirect (X), Indirect (Y):
+            case 17:
+                Reference = E.D + E.X;
+                Reference2 = E.D + E.Y;
+                break;
+
+            // Absolute Indexed Indirect, [!abs+X]:
+            case 18:
+                Reference = (Word + E.X) & 0xFFFF;
+                IndirectReference = Pointer;
+                break;
+
+            // TCALL n, through the vector table:
+            case 19:
+                Reference = 0xFFDE - ((Opcode >> 4) << 1);
+                IndirectReference = Pointer;
+                break;
 
-            // TODO: technically DMA could also be indirect.
-            if (Reference == 0x420B)
-                DMALastPC = PC;
+            // PCALL:
+            case 20:
+                Reference = 0xFF00 + Operands[0];
+                break;
         }
 
-        if (IndirectReference != UNDEFINED)
-            this->IndirectReferences.insert(IndirectReference);
+        TriggersDMA = false;
+
+        AddReference(Reference, DIRECT_REFERENCE, NewReferences);
+        AddReference(Reference2, DIRECT_REFERENCE, NewReferences);
+        AddReference(IndirectReference, INDIRECT_REFERENCE, NewReferences);
+        Cache(E, SPC700DecodeInputs[Mode]);
+    }
+
+private:
+    void AddReference(int Reference, uint8 Type, std::vector<SReferenceRow>& NewReferences)
+    {
+        if (Reference == UNDEFINED)
+            return;
+
+        SReferenceSet& Set = Type == DIRECT_REFERENCE ? References : IndirectReferences;
+        if (Set.Insert(Reference))
+            NewReferences.push_back({PC, Reference, Type});
+    }
+
+    void Cache(const SInstructionEvent& E, uint8 ModeInputs)
+    {
+        // Memory-dependent decodes can't be reused:
+        Inputs = ModeInputs;
+        Cached = !(Inputs & INPUT_MEMORY);
+        CachedCode = E.Code;
+        CachedDB = E.DB;
+        CachedD  = E.D;
+        CachedX  = E.X;
+        CachedY  = E.Y;
     }
 };
 
@@ -303,125 +889,2112 @@ template<> struct std::hash<SDMATransfer>
     }
 };
 
-static std::unordered_map<uint32, SInstruction> Instructions;
-static std::unordered_map<uint32, VectorType> Vectors;
-static std::unordered_set<SDMATransfer> DMATransfers;
-
-void GilgameshTrace(uint8 Bank, uint16 Address)
-{
-    uint32 PC = (Bank << 16) | Address;
-
-    /* Search instruction by PC.
-     * - If it's already present, fetch it.
-     * - Otherwise, create an "empty" instruction with the given PC.
-     * Then decode the instruction. */
-    Instructions.emplace(std::piecewise_construct,
-                         std::forward_as_tuple(PC),
-                         std::forward_as_tuple(PC)).first->second.Decode();
-}
-
-void GilgameshTraceVector(uint32 PC, VectorType Type)
+/* Everything traced about the instruction stream of one processor.
+ *
+ * Instructions are stored densely, in order of first execution. They're
+ * looked up through a two-level direct index over the 24-bit address
+ * space: one page of (index + 1) per 64 KiB bank, allocated on first use. */
+struct SProcessorTrace
 {
-    Vectors[PC] = Type;
-}
+    std::vector<SInstruction> Instructions;
+    uint32* InstructionPages[0x100] = {};
 
-void GilgameshTraceDMA(SDMA& DMA)
-{
-    // Only log incrementing CPU -> PPU stuff for now:
-    if (DMA.ReverseTransfer || DMA.TransferMode > 2 || DMA.AAddressFixed || DMA.AAddressDecrement)
-        return;
+    std::unordered_map<uint32, VectorType> Vectors;
 
-    SDMATransfer DMATransfer;
-    DMATransfer.pc     = DMALastPC;
-    DMATransfer.source = (unsigned) ((DMA.ABank << 16) | DMA.AAddress);
-    DMATransfer.bytes  = (unsigned) DMA.TransferBytes;
+    // Rows added or changed since the last checkpoint:
+    std::vector<uint32> DirtyInstructions;      // Indices into Instructions.
+    std::vector<SReferenceRow> NewReferences;
+    std::vector<std::pair<uint32, VectorType>> NewVectors;
 
-    switch (DMA.BAddress)
+    SInstruction& FindInstruction(uint32 PC)
     {
-        // VRAM:
-        case 0x18:
-        case 0x19:
-            DMATransfer.destination = DMA_VRAM;
-            break;
+        uint32*& Page = InstructionPages[(PC >> 16) & 0xFF];
+        if (Page == NULL)
+            Page = (uint32*) calloc(0x10000, sizeof(uint32));
 
-        // CGRAM:
-        case 0x22:
-            DMATransfer.destination = DMA_CGRAM;
-            break;
+        uint32& Index = Page[PC & 0xFFFF];
+        if (Index == 0)
+        {
+            Instructions.emplace_back(PC);
+            Index = Instructions.size();
+        }
 
-        // OBJADDR:
-        case 0x04:
-            DMATransfer.destination = DMA_OAM;
-            break;
+        return Instructions[Index - 1];
     }
 
-    DMATransfers.insert(DMATransfer);
-}
-
-void GilgameshSave()
-{
-    std::string DatabasePath = S9xGetDirectory(LOG_DIR);
-    DatabasePath += "/gilgamesh.db";
-
-    int Status = sqlite3_open(DatabasePath.c_str(), &Database);
-    if (Status != SQLITE_OK)
+    void MarkDirty(SInstruction& I)
     {
-        fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(Database));
-        return;
+        if (!I.Dirty)
+        {
+            I.Dirty = true;
+            DirtyInstructions.push_back(&I - Instructions.data());
+        }
     }
+};
 
-    SQL("DROP TABLE IF EXISTS instructions");
-    SQL("CREATE TABLE instructions(pc      INTEGER PRIMARY KEY,"
-                                  "opcode  INTEGER NOT NULL,"
-                                  "flags   INTEGER NOT NULL,"
-                                  "operand INTEGER)");
+static const int PROCESSOR_COUNT = PROCESSOR_SPC700 + 1;
+static SProcessorTrace Processors[PROCESSOR_COUNT];
 
-    SQL("DROP TABLE IF EXISTS references_");
-    SQL("CREATE TABLE references_(pointer INTEGER,"
-                                 "pointee INTEGER,"
-                                 "type    INTEGER,"
-                                 "PRIMARY KEY (pointer, pointee, type))");
+static std::unordered_set<SDMATransfer> DMATransfers;
+static std::vector<SDMATransfer> NewDMATransfers;
+
+/* Shadow call stack, driven by JSR/JSL/RTS/RTL/RTI and the vectors.
+ *
+ * An instruction only takes effect once it's known to have been
+ * dispatched: when the next instruction is traced (which also brings its
+ * cycles), or when an interrupt is taken right after it. Returns are
+ * matched against the return address of the frames on the stack, so that
+ * stack tricks (pushing an address and RTS-ing to it) don't unbalance it. */
+enum { FRAME_SUBROUTINE = VECTOR_IRQ + 1 };     // Other kinds are VectorTypes.
+enum { NO_NODE = 0xFFFFFFFF };
+
+static const uint32 MAX_CALL_DEPTH = 1024;
+
+// One node per distinct call path, for the folded stacks.
+struct SPathNode
+{
+    uint32 Parent;
+    uint32 Entry;
+    uint8  Kind;
+    uint64 Cycles;          // Exclusive, since the start of the session.
+};
 
-    SQL("DROP TABLE IF EXISTS dma");
-    SQL("CREATE TABLE dma(pc          INTEGER,"
-                         "source      INTEGER,"
-                         "destination INTEGER,"
-                         "bytes       INTEGER,"
-                         "PRIMARY KEY (pc, source, destination, bytes))");
+// Caller -> callee statistics, since the last checkpoint.
+struct SCallEdge
+{
+    uint32 Calls;
+    uint64 Inclusive;
+    uint64 Exclusive;
+};
 
-    SQL("DROP TABLE IF EXISTS vectors");
-    SQL("CREATE TABLE vectors(pc   INTEGER PRIMARY KEY,"
-                             "type INTEGER NOT NULL)");
+struct SCallRow
+{
+    int       Caller;       // UNDEFINED for the outermost frame.
+    uint32    Callee;
+    SCallEdge Edge;
+};
 
-    SQL("BEGIN TRANSACTION");
-    for (auto& KeyValue: Instructions)
+struct SFrame
+{
+    uint32 Entry;
+    int    ReturnPC;        // UNDEFINED for interrupts.
+    uint32 Node;
+    uint8  Kind;
+    uint8  DeferredReturn;  // Return opcode interrupted before taking effect.
+    uint64 Start;
+    uint64 Exclusive;
+};
+
+static std::vector<SPathNode> PathNodes;
+static std::unordered_map<uint64, uint32> PathIndex;
+static std::unordered_map<uint64, SCallEdge> CallEdges;
+static std::vector<SFrame> CallStack;
+static uint64 CycleCount;   // Cycles of every dispatched instruction.
+
+// Last traced instruction, until it takes effect:
+static bool   LastPending;
+static bool   LastResolved;
+static uint32 LastDepth;
+static uint8  LastOpcode;
+static uint32 LastTarget;
+static int    LastReturnPC;
+
+static uint32 FindPathNode(uint32 Parent, uint32 Entry, uint8 Kind)
+{
+    uint64 Key = (uint64) Parent << 32 | Kind << 24 | Entry;
+    auto Result = PathIndex.emplace(Key, PathNodes.size());
+    if (Result.second)
+        PathNodes.push_back({Parent, Entry, Kind, 0});
+    return Result.first->second;
+}
+
+static bool PushFrame(uint32 Entry, uint8 Kind, int ReturnPC)
+{
+    if (CallStack.size() == MAX_CALL_DEPTH)
+        return false;
+
+    uint32 Parent = CallStack.empty() ? (uint32) NO_NODE : CallStack.back().Node;
+    CallStack.push_back({Entry, ReturnPC, FindPathNode(Parent, Entry, Kind), Kind, 0, CycleCount, 0});
+    return true;
+}
+
+static SCallEdge& FindCallEdge(uint32 Depth)
+{
+    int Caller = Depth ? (int) CallStack[Depth - 1].Entry : UNDEFINED;
+    return CallEdges[(uint64) (uint32) Caller << 32 | CallStack[Depth].Entry];
+}
+
+static void PopFrame()
+{
+    SFrame& F = CallStack.back();
+    SCallEdge& Edge = FindCallEdge(CallStack.size() - 1);
+    Edge.Calls++;
+    Edge.Inclusive += CycleCount - F.Start;
+    Edge.Exclusive += F.Exclusive;
+    CallStack.pop_back();
+}
+
+static bool IsCall(uint8 Opcode)
+{
+    return Opcode == 0x20 || Opcode == 0x22 || Opcode == 0xFC;     // JSR, JSL, JSR (a,x)
+}
+
+static bool IsReturn(uint8 Opcode)
+{
+    return Opcode == 0x60 || Opcode == 0x6B || Opcode == 0x40;     // RTS, RTL, RTI
+}
+
+static void Return(uint8 Opcode, uint32 Target)
+{
+    int Depth = CallStack.size() - 1;
+
+    if (Opcode == 0x40)
+    {
+        while (Depth >= 0 && (CallStack[Depth].Kind == FRAME_SUBROUTINE || CallStack[Depth].Kind == VECTOR_RESET))
+            Depth--;
+    }
+    else
+    {
+        while (Depth >= 0 && CallStack[Depth].ReturnPC != (int) Target)
+            Depth--;
+    }
+
+    // Not a return from anything on the stack (e.g. a jump through RTS):
+    if (Depth < 0)
+        return;
+
+    uint8 Deferred = CallStack[Depth].DeferredReturn;
+    while ((int) CallStack.size() > Depth)
+        PopFrame();
+    if (Deferred)
+        Return(Deferred, Target);
+}
+
+static void TraceCalls(const SInstructionEvent& E)
+{
+    if (LastPending && E.PrevCount)
+    {
+        CycleCount += E.PrevCycles;
+        if (LastDepth < CallStack.size())
+        {
+            SFrame& F = CallStack[LastDepth];
+            F.Exclusive += E.PrevCycles;
+            PathNodes[F.Node].Cycles += E.PrevCycles;
+
+            // Frames entered after the instruction, by an interrupt, start after it:
+            for (uint32 i = LastDepth + 1; i < CallStack.size(); i++)
+                CallStack[i].Start += E.PrevCycles;
+        }
+
+        // After a gap, E doesn't tell where the last instruction went:
+        if (!LastResolved && !E.AfterGap)
+        {
+            if (IsCall(LastOpcode))
+                PushFrame(E.PC, FRAME_SUBROUTINE, LastReturnPC);
+            else if (IsReturn(LastOpcode))
+                Return(LastOpcode, E.PC);
+        }
+    }
+    CycleCount += E.GapCycles;
+
+    if (CallStack.empty())
+        PushFrame(E.PC, FRAME_SUBROUTINE, UNDEFINED);
+
+    uint32 Bank = E.PC & 0xFF0000;
+    uint16 Operand = (E.Bytes[2] << 8) | E.Bytes[1];
+
+    LastPending  = true;
+    LastResolved = false;
+    LastDepth    = CallStack.size() - 1;
+    LastOpcode   = E.Bytes[0];
+    switch (LastOpcode)
+    {
+        case 0x20:
+            LastTarget   = Bank | Operand;
+            LastReturnPC = Bank | (uint16) (E.PC + 3);
+            break;
+        case 0xFC:
+            LastTarget   = Bank | (E.Pointer[1] << 8) | E.Pointer[0];
+            LastReturnPC = Bank | (uint16) (E.PC + 3);
+            break;
+        case 0x22:
+            LastTarget   = (E.Bytes[3] << 16) | Operand;
+            LastReturnPC = Bank | (uint16) (E.PC + 4);
+            break;
+    }
+}
+
+static void TraceInterrupt(const SVectorEvent& V)
+{
+    if (V.Type == VECTOR_RESET)
+    {
+        while (!CallStack.empty())
+            PopFrame();
+        LastPending = false;
+        PushFrame(V.PC, V.Type, UNDEFINED);
+        return;
+    }
+
+    uint8 Deferred = 0;
+    if (LastPending && !LastResolved)
+    {
+        if (!V.Dispatched)
+            // It will be traced again once the interrupt returns.
+            LastPending = false;
+        else
+        {
+            if (IsCall(LastOpcode))
+                PushFrame(LastTarget, FRAME_SUBROUTINE, LastReturnPC);
+            else if (IsReturn(LastOpcode))
+                Deferred = LastOpcode;
+            LastResolved = true;
+        }
+    }
+
+    if (PushFrame(V.PC, V.Type, UNDEFINED))
+        CallStack.back().DeferredReturn = Deferred;
+}
+
+/* Shadow memory. The emulation thread updates the arrays on every access,
+ * and copies the pages that changed into each checkpoint request. */
+static const uint32 SHADOW_PAGE_SIZE = 1 << SHADOW_PAGE_SHIFT;
+
+static uint32 WRAMWriters[0x20000], WRAMReaders[0x20000];
+static uint32 SRAMWriters[0x20000], SRAMReaders[0x20000];
+static uint32 VRAMWriters[0x10000], VRAMReaders[0x10000];
+static uint8  WRAMAccess[0x20000], WRAMDirtyPages[0x20000 / SHADOW_PAGE_SIZE];
+static uint8  SRAMAccess[0x20000], SRAMDirtyPages[0x20000 / SHADOW_PAGE_SIZE];
+static uint8  VRAMAccess[0x10000], VRAMDirtyPages[0x10000 / SHADOW_PAGE_SIZE];
+
+SShadowMemory GilgameshShadow[3] =
+{
+    { WRAMWriters, WRAMReaders, WRAMAccess, WRAMDirtyPages, 0x20000 },
+    { SRAMWriters, SRAMReaders, SRAMAccess, SRAMDirtyPages, 0x20000 },
+    { VRAMWriters, VRAMReaders, VRAMAccess, VRAMDirtyPages, 0x10000 },
+};
+uint32 GilgameshPC;
+uint32 GilgameshHDMAPC;
+
+struct SShadowPage
+{
+    MemorySpace Space;
+    uint32 Offset;
+    uint32 Writers[SHADOW_PAGE_SIZE];
+    uint32 Readers[SHADOW_PAGE_SIZE];
+    uint8  Access[SHADOW_PAGE_SIZE];
+};
+
+// Runs on the emulation thread.
+static std::vector<SShadowPage>* CopyDirtyPages()
+{
+    std::vector<SShadowPage>* Pages = new std::vector<SShadowPage>;
+
+    for (int Space = MEMORY_WRAM; Space <= MEMORY_VRAM; Space++)
+    {
+        SShadowMemory& Shadow = GilgameshShadow[Space];
+        for (uint32 Page = 0; Page < Shadow.Size / SHADOW_PAGE_SIZE; Page++)
+        {
+            if (!Shadow.DirtyPages[Page])
+                continue;
+            Shadow.DirtyPages[Page] = 0;
+
+            Pages->emplace_back();
+            SShadowPage& P = Pages->back();
+            P.Space  = (MemorySpace) Space;
+            P.Offset = Page * SHADOW_PAGE_SIZE;
+            memcpy(P.Writers, Shadow.Writers + P.Offset, sizeof(P.Writers));
+            memcpy(P.Readers, Shadow.Readers + P.Offset, sizeof(P.Readers));
+            memcpy(P.Access,  Shadow.Access  + P.Offset, sizeof(P.Access));
+        }
+    }
+
+    return Pages;
+}
+
+/* Checkpoints: a frozen copy of everything that changed since the previous
+ * one, written by a separate thread so that neither the emulation nor the
+ * aggregation ever wait on the disk. */
+struct SCheckpoint
+{
+    std::vector<SInstructionRow> Instructions[PROCESSOR_COUNT];
+    std::vector<SReferenceRow> References[PROCESSOR_COUNT];
+    std::vector<std::pair<uint32, VectorType>> Vectors[PROCESSOR_COUNT];
+    std::vector<SDMATransfer> DMATransfers;
+    std::vector<SCallRow> Calls;
+    std::vector<SPathNode> PathNodes;
+    std::vector<SShadowPage> Memory;
+    std::vector<uint8> Columns;     // Columnar export, when closing with -columns.
+    bool Close;
+};
+
+static std::mutex WriterMutex;
+static std::condition_variable& WriterWake = *new std::condition_variable;   // Never destroyed, see AggregatorWake.
+static std::deque<SCheckpoint*> WriterQueue;
+static std::thread* Writer;
+static bool SchemaCreated;
+
+static bool WriteCheckpoint(const SCheckpoint& C);
+
+static void WriteColumns(const std::vector<uint8>& Columns)
+{
+    std::string Path = S9xGetDirectory(LOG_DIR);
+    Path += "/gilgamesh.columns";
+
+    FILE* File = fopen(Path.c_str(), "wb");
+    if (File == NULL || fwrite(Columns.data(), Columns.size(), 1, File) != 1)
+        fprintf(stderr, "Cannot write %s\n", Path.c_str());
+    if (File != NULL)
+        fclose(File);
+}
+
+template<typename T> static void Prepend(std::vector<T>& Rows, std::vector<T>& Earlier)
+{
+    Earlier.insert(Earlier.end(), Rows.begin(), Rows.end());
+    Rows.swap(Earlier);
+}
+
+/* A checkpoint that failed to commit is rolled back: its rows go in front
+ * of the next one's, where later rows win and profile deltas add up. */
+static void CarryOver(SCheckpoint& C, SCheckpoint& Failed)
+{
+    for (int Processor = 0; Processor < PROCESSOR_COUNT; Processor++)
+    {
+        Prepend(C.Instructions[Processor], Failed.Instructions[Processor]);
+        Prepend(C.References[Processor], Failed.References[Processor]);
+        Prepend(C.Vectors[Processor], Failed.Vectors[Processor]);
+    }
+    Prepend(C.DMATransfers, Failed.DMATransfers);
+    Prepend(C.Calls, Failed.Calls);
+    Prepend(C.Memory, Failed.Memory);
+}
+
+// Runs until it has written a checkpoint that closes the database.
+static void WriterMain()
+{
+    SCheckpoint* Failed = NULL;
+    bool Close = false;
+
+    while (!Close)
+    {
+        SCheckpoint* C;
+        {
+            std::unique_lock<std::mutex> Lock(WriterMutex);
+            WriterWake.wait(Lock, [] { return !WriterQueue.empty(); });
+            C = WriterQueue.front();
+            WriterQueue.pop_front();
+        }
+
+        if (Failed != NULL)
+        {
+            CarryOver(*C, *Failed);
+            delete Failed;
+            Failed = NULL;
+        }
+
+        bool Written = WriteCheckpoint(*C);
+        if (!C->Columns.empty())
+            WriteColumns(C->Columns);
+        Close = C->Close;
+
+        if (!Written && !Close)
+            Failed = C;
+        else
+        {
+            if (!Written)
+                fprintf(stderr, "Cannot write the last checkpoint\n");
+            delete C;
+        }
+    }
+}
+
+/* Columnar export (see gilgamesh_columns.h). The aggregator lays out the
+ * whole file in memory from its tables, the writer only dumps it. */
+template<typename T> static uint8* PutLittleEndian(uint8* Out, T Value)
+{
+    typename std::make_unsigned<T>::type Bits = Value;
+    for (size_t i = 0; i < sizeof(T); i++, Bits >>= 8)
+        *Out++ = (uint8) Bits;
+    return Out;
+}
+
+template<typename T> static uint64 AppendColumn(std::vector<uint8>& File, const std::vector<T>& Column)
+{
+    uint64 Offset = (File.size() + 7) & ~(uint64) 7;
+    File.resize(Offset + Column.size() * sizeof(T));
+
+    uint8* Out = File.data() + Offset;
+    for (T Value: Column)
+        Out = PutLittleEndian(Out, Value);
+    return Offset;
+}
+
+// Field by field, in the order of SColumnsHeader.
+static void PutColumnsHeader(uint8* Out, const SColumnsHeader& Header)
+{
+    memcpy(Out, Header.Magic, sizeof(Header.Magic));
+    Out = PutLittleEndian(Out + sizeof(Header.Magic), Header.Version);
+    Out = PutLittleEndian(Out, Header.ROMCRC32);
+
+    for (const SColumnsTable& Table: Header.Tables)
+        for (uint64 Field: {Table.InstructionCount, Table.ReferenceCount, Table.PC, Table.Opcode, Table.Flags,
+                            Table.Operand, Table.Executions, Table.Cycles, Table.ReferenceStart, Table.Pointee,
+                            Table.ReferenceType, Table.ByPointee, Table.ByPointeeInstruction})
+            Out = PutLittleEndian(Out, Field);
+}
+
+static void ExportColumns(std::vector<uint8>& File)
+{
+    SColumnsHeader Header = {};
+    memcpy(Header.Magic, COLUMNS_MAGIC, sizeof(Header.Magic));
+    Header.Version = COLUMNS_VERSION;
+    Header.ROMCRC32 = Memory.ROMCRC32;
+    File.resize(sizeof(Header));
+
+    for (int Processor = 0; Processor < PROCESSOR_COUNT; Processor++)
+    {
+        const SProcessorTrace& P = Processors[Processor];
+        std::vector<uint32> PC, ReferenceStart, ByPointeeInstruction;
+        std::vector<uint8> Opcode, Flags, ReferenceType;
+        std::vector<int> Operand, Pointee, ByPointee;
+        std::vector<uint64> Executions, Cycles;
+        std::vector<std::pair<int, uint8>> References;
+        std::vector<std::pair<int, uint32>> Reverse;
+
+        // The index pages give the instructions in order of PC:
+        for (int Bank = 0; Bank < 0x100; Bank++)
+        {
+            const uint32* Page = P.InstructionPages[Bank];
+            for (uint32 Address = 0; Page != NULL && Address < 0x10000; Address++)
+            {
+                if (Page[Address] == 0)
+                    continue;
+
+                const SInstruction& I = P.Instructions[Page[Address] - 1];
+                uint32 Row = PC.size();
+                PC.push_back(I.PC);
+                Opcode.push_back(I.Opcode);
+                Flags.push_back(I.Flags);
+                Operand.push_back(I.Operand);
+                Executions.push_back(I.CheckpointedExecutions + I.Executions);
+                Cycles.push_back(I.CheckpointedCycles + I.Cycles);
+
+                References.clear();
+                I.References.ForEach([&](int R) { References.emplace_back(R, DIRECT_REFERENCE); });
+                I.IndirectReferences.ForEach([&](int R) { References.emplace_back(R, INDIRECT_REFERENCE); });
+                std::sort(References.begin(), References.end());
+
+                ReferenceStart.push_back(Pointee.size());
+                for (const auto& R : References)
+                {
+                    Pointee.push_back(R.first);
+                    ReferenceType.push_back(R.second);
+                    Reverse.emplace_back(R.first, Row);
+                }
+            }
+        }
+        ReferenceStart.push_back(Pointee.size());
+
+        std::sort(Reverse.begin(), Reverse.end());
+        for (const auto& R : Reverse)
+        {
+            ByPointee.push_back(R.first);
+            ByPointeeInstruction.push_back(R.second);
+        }
+
+        SColumnsTable& Table = Header.Tables[Processor];
+        Table.InstructionCount     = PC.size();
+        Table.ReferenceCount       = Pointee.size();
+        Table.PC                   = AppendColumn(File, PC);
+        Table.Opcode               = AppendColumn(File, Opcode);
+        Table.Flags                = AppendColumn(File, Flags);
+        Table.Operand              = AppendColumn(File, Operand);
+        Table.Executions           = AppendColumn(File, Executions);
+        Table.Cycles               = AppendColumn(File, Cycles);
+        Table.ReferenceStart       = AppendColumn(File, ReferenceStart);
+        Table.Pointee              = AppendColumn(File, Pointee);
+        Table.ReferenceType        = AppendColumn(File, ReferenceType);
+        Table.ByPointee            = AppendColumn(File, ByPointee);
+        Table.ByPointeeInstruction = AppendColumn(File, ByPointeeInstruction);
+    }
+
+    PutColumnsHeader(File.data(), Header);
+}
+
+static void Checkpoint(bool Close, std::vector<SShadowPage>* Memory)
+{
+    SCheckpoint* C = new SCheckpoint;
+
+    for (int Processor = 0; Processor < PROCESSOR_COUNT; Processor++)
+    {
+        SProcessorTrace& P = Processors[Processor];
+
+        C->Instructions[Processor].reserve(P.DirtyInstructions.size());
+        for (uint32 Index: P.DirtyInstructions)
+        {
+            SInstruction& I = P.Instructions[Index];
+            I.Dirty = false;
+            C->Instructions[Processor].push_back({I.PC, I.Opcode, I.Flags, I.Operand, I.Executions, I.Cycles});
+            I.CheckpointedExecutions += I.Executions;
+            I.CheckpointedCycles += I.Cycles;
+            I.Executions = 0;
+            I.Cycles = 0;
+        }
+        P.DirtyInstructions.clear();
+
+        C->References[Processor].swap(P.NewReferences);
+        C->Vectors[Processor].swap(P.NewVectors);
+    }
+    C->DMATransfers.swap(NewDMATransfers);
+
+    // Account for the frames still running so far, as if they returned now:
+    for (uint32 Depth = 0; Depth < CallStack.size(); Depth++)
+    {
+        SFrame& F = CallStack[Depth];
+        SCallEdge& Edge = FindCallEdge(Depth);
+        Edge.Inclusive += CycleCount - F.Start;
+        Edge.Exclusive += F.Exclusive;
+        F.Start = CycleCount;
+        F.Exclusive = 0;
+    }
+    for (auto& KeyValue: CallEdges)
+        C->Calls.push_back({(int) (KeyValue.first >> 32), (uint32) KeyValue.first, KeyValue.second});
+    CallEdges.clear();
+    C->PathNodes = PathNodes;
+
+    C->Memory.swap(*Memory);
+    delete Memory;
+
+    if (Close && Settings.GilgameshColumns)
+        ExportColumns(C->Columns);
+    C->Close = Close;
+
+    std::lock_guard<std::mutex> Lock(WriterMutex);
+    if (Writer == NULL)
+        Writer = new std::thread(WriterMain);
+    WriterQueue.push_back(C);
+    WriterWake.notify_one();
+}
+
+/* Execution log (see gilgamesh_exec.h). The aggregator encodes the main
+ * CPU's instructions into blocks, which a thread of their own deflates and
+ * appends to the log, so that neither emulation nor aggregation waits on
+ * zlib or the disk. */
+static const uint32 EXEC_BLOCK_SIZE = 256 << 10;
+
+struct SExecBlock
+{
+    SExecBlockHeader Header;
+    std::vector<uint8> Data;
+    bool Close;             // Last block: close the log once written.
+};
+
+static SExecBlock* ExecBlock;       // Being filled by the aggregator.
+static SExecState ExecState;        // Last record encoded in it.
+static uint32 ExecFrame;
+static bool ExecLogActive;
+
+static std::mutex ExecLogMutex;
+static std::condition_variable& ExecLogWake = *new std::condition_variable;   // Never destroyed, see AggregatorWake.
+static std::deque<SExecBlock*> ExecLogQueue;
+static std::thread* ExecLogWriter;
+
+static FILE* OpenExecFile(const char* Name, const uint8* Header, size_t Size)
+{
+    std::string Path = S9xGetDirectory(LOG_DIR);
+    Path += Name;
+
+    FILE* File = fopen(Path.c_str(), "wb");
+    if (File == NULL)
+        fprintf(stderr, "Cannot write %s\n", Path.c_str());
+    else
+        fwrite(Header, Size, 1, File);
+    return File;
+}
+
+static void ExecLogWriterMain()
+{
+    SExecLogHeader LogHeader = {};
+    memcpy(LogHeader.Magic, EXEC_LOG_MAGIC, sizeof(LogHeader.Magic));
+    LogHeader.Version = EXEC_LOG_VERSION;
+    LogHeader.ROMCRC32 = Memory.ROMCRC32;
+
+    SExecIndexHeader IndexHeader = {};
+    memcpy(IndexHeader.Magic, EXEC_INDEX_MAGIC, sizeof(IndexHeader.Magic));
+    IndexHeader.Version = EXEC_LOG_VERSION;
+
+    // Opened with the first block, whose frame the index starts at.
+    FILE* Log = NULL;
+    FILE* Index = NULL;
+    bool Opened = false;
+    uint8 Serialized[EXEC_BLOCK_HEADER_SIZE];
+    uint64 Offset = EXEC_LOG_HEADER_SIZE;
+    uint32 IndexedFrames = 0;
+    std::vector<uint8> Compressed;
+    bool Close = false;
+
+    while (!Close)
+    {
+        SExecBlock* B;
+        {
+            std::unique_lock<std::mutex> Lock(ExecLogMutex);
+            ExecLogWake.wait(Lock, [] { return !ExecLogQueue.empty(); });
+            B = ExecLogQueue.front();
+            ExecLogQueue.pop_front();
+        }
+
+        Close = B->Close;
+        if (B->Header.Records && !Opened)
+        {
+            Opened = true;
+            IndexHeader.FirstFrame = IndexedFrames = B->Header.Frame;
+            ExecPutLogHeader(Serialized, LogHeader);
+            Log = OpenExecFile("/gilgamesh.exec", Serialized, EXEC_LOG_HEADER_SIZE);
+            ExecPutIndexHeader(Serialized, IndexHeader);
+            Index = OpenExecFile("/gilgamesh.exec.idx", Serialized, EXEC_INDEX_HEADER_SIZE);
+        }
+        if (B->Header.Records && Log != NULL && Index != NULL)
+        {
+            const uint8* Data = B->Data.data();
+        #ifdef ZLIB
+            uLongf CompressedSize = compressBound(B->Header.RawSize);
+            Compressed.resize(CompressedSize);
+            if (compress2(Compressed.data(), &CompressedSize, Data, B->Header.RawSize, Z_BEST_SPEED) == Z_OK &&
+                CompressedSize < B->Header.RawSize)
+            {
+                B->Header.CompressedSize = CompressedSize;
+                Data = Compressed.data();
+            }
+        #endif
+            uint32 Size = B->Header.CompressedSize ? B->Header.CompressedSize : B->Header.RawSize;
+
+            // Frames that started no block point at the next one.
+            ExecPutQuad(Serialized, Offset);
+            for (; IndexedFrames <= B->Header.Frame; IndexedFrames++)
+                fwrite(Serialized, sizeof(Offset), 1, Index);
+
+            ExecPutBlockHeader(Serialized, B->Header);
+            fwrite(Serialized, EXEC_BLOCK_HEADER_SIZE, 1, Log);
+            fwrite(Data, Size, 1, Log);
+            Offset += EXEC_BLOCK_HEADER_SIZE + Size;
+
+            // Readable as it grows:
+            fflush(Log);
+            fflush(Index);
+        }
+        delete B;
+    }
+
+    if (Log != NULL)
+        fclose(Log);
+    if (Index != NULL)
+        fclose(Index);
+}
+
+static void SubmitExecBlock(bool Close)
+{
+    std::lock_guard<std::mutex> Lock(ExecLogMutex);
+    if (ExecBlock == NULL)
+    {
+        // Nothing to write, nor to close:
+        if (!Close || ExecLogWriter == NULL)
+            return;
+        ExecBlock = new SExecBlock();
+    }
+
+    ExecBlock->Close = Close;
+    if (ExecLogWriter == NULL)
+        ExecLogWriter = new std::thread(ExecLogWriterMain);
+    ExecLogQueue.push_back(ExecBlock);
+    ExecLogWake.notify_one();
+    ExecBlock = NULL;
+}
+
+static void LogExecution(const SInstructionEvent& E)
+{
+    bool Keyframe = ExecBlock == NULL;
+    if (Keyframe)
+    {
+        ExecBlock = new SExecBlock();
+        ExecBlock->Header.Frame = ExecFrame;
+        ExecBlock->Header.Cycles = CycleCount;
+        ExecBlock->Data.resize(EXEC_BLOCK_SIZE + EXEC_MAX_RECORD);
+    }
+
+    SExecState Next;
+    Next.PC     = E.PC;
+    Next.Opcode = E.Bytes[0];
+    Next.P      = E.P;
+    Next.DB     = E.DB;
+    Next.D      = E.D;
+    Next.A      = E.A;
+    Next.X      = E.X;
+    Next.Y      = E.Y;
+    Next.S      = E.S;
+    Next.Cycles = Keyframe ? 0 : E.PrevCycles + E.GapCycles;
+
+    SExecBlockHeader& Header = ExecBlock->Header;
+    uint8* End = ExecEncode(ExecBlock->Data.data() + Header.RawSize, ExecState, Next, Keyframe);
+    Header.RawSize = End - ExecBlock->Data.data();
+    Header.Records++;
+
+    if (Header.RawSize >= EXEC_BLOCK_SIZE)
+        SubmitExecBlock(false);
+}
+
+/* Live queries. A thread serves a UNIX socket in the log directory, one
+ * line per query. The tables belong to the aggregator, so it's the one
+ * that answers, between two batches of events; the emulation thread never
+ * takes part, nor waits. */
+static std::mutex QueryMutex;
+static std::condition_variable QueryAnswered;
+static std::atomic<bool> QueryPending(false);
+static ProcessorType QueryProcessor;
+static std::string QueryText;
+static std::string QueryReply;
+
+// Parses "$BB:AAAA-$BB:AAAA" or "$BB:AAAA" and skips past it.
+static bool ParseRange(const char*& Text, uint32& First, uint32& Last)
+{
+    unsigned FirstBank, FirstAddress, LastBank, LastAddress;
+    int Length = 0;
+
+    if (sscanf(Text, "$%x:%x-$%x:%x%n", &FirstBank, &FirstAddress, &LastBank, &LastAddress, &Length) != 4)
+    {
+        if (sscanf(Text, "$%x:%x%n", &FirstBank, &FirstAddress, &Length) != 2)
+            return false;
+        LastBank = FirstBank;
+        LastAddress = FirstAddress;
+    }
+
+    First = ((FirstBank & 0xFF) << 16) | (FirstAddress & 0xFFFF);
+    Last  = ((LastBank & 0xFF) << 16) | (LastAddress & 0xFFFF);
+    Text += Length;
+    return true;
+}
+
+static void AppendInstruction(std::string& Reply, const SInstruction& I)
+{
+    char Line[128];
+    snprintf(Line, sizeof(Line), "$%02X:%04X opcode=%02X flags=%02X executions=%llu cycles=%llu\n",
+             I.Bank, I.Address, I.Opcode, I.Flags,
+             (unsigned long long) (I.CheckpointedExecutions + I.Executions),
+             (unsigned long long) (I.CheckpointedCycles + I.Cycles));
+    Reply += Line;
+}
+
+static std::string RunQuery(ProcessorType Processor, const std::string& Query)
+{
+    const SProcessorTrace& P = Processors[Processor];
+    std::string Reply;
+    char Command[16];
+    int Length = 0;
+    uint32 First, Last;
+
+    if (sscanf(Query.c_str(), "%15s %n", Command, &Length) != 1)
+        return "error: empty query\n";
+    const char* Arguments = Query.c_str() + Length;
+    if (!ParseRange(Arguments, First, Last) || *Arguments != '\0')
+        return "error: expected an address like $7E:0100 or a range like $00:8000-$00:FFFF\n";
+
+    // Has the instruction at this address run? With its profile, if so.
+    if (!strcmp(Command, "executed"))
+    {
+        const uint32* Page = P.InstructionPages[First >> 16];
+        if (Page == NULL || Page[First & 0xFFFF] == 0)
+            return "no\n";
+        AppendInstruction(Reply, P.Instructions[Page[First & 0xFFFF] - 1]);
+    }
+    // Every instruction run within a range of addresses.
+    else if (!strcmp(Command, "instructions"))
+    {
+        for (uint32 PC = First; PC <= Last && PC <= 0xFFFFFF; PC++)
+        {
+            const uint32* Page = P.InstructionPages[PC >> 16];
+            if (Page == NULL)
+                PC |= 0xFFFF;
+            else if (Page[PC & 0xFFFF])
+                AppendInstruction(Reply, P.Instructions[Page[PC & 0xFFFF] - 1]);
+        }
+    }
+    // Every instruction that references an address within a range.
+    else if (!strcmp(Command, "references"))
+    {
+        for (const SInstruction& I : P.Instructions)
+        {
+            auto Append = [&](const char* Type, int Pointee)
+            {
+                char Line[64];
+                if ((uint32) Pointee < First || (uint32) Pointee > Last)
+                    return;
+                snprintf(Line, sizeof(Line), "$%02X:%04X %s $%02X:%04X\n", I.Bank, I.Address, Type,
+                         (Pointee >> 16) & 0xFF, Pointee & 0xFFFF);
+                Reply += Line;
+            };
+            I.References.ForEach([&](int Pointee) { Append("direct", Pointee); });
+            I.IndirectReferences.ForEach([&](int Pointee) { Append("indirect", Pointee); });
+        }
+    }
+    else
+        return "error: unknown query\n";
+
+    return Reply;
+}
+
+static void WakeAggregator();
+
+// Called by the aggregator when a query is pending.
+static void AnswerQuery()
+{
+    std::lock_guard<std::mutex> Lock(QueryMutex);
+    QueryReply = RunQuery(QueryProcessor, QueryText);
+    QueryPending.store(false, std::memory_order_relaxed);
+    QueryAnswered.notify_one();
+}
+
+// Called by the query server: hands the query to the aggregator and waits.
+static std::string AskAggregator(ProcessorType Processor, const std::string& Query)
+{
+    std::unique_lock<std::mutex> Lock(QueryMutex);
+    QueryProcessor = Processor;
+    QueryText = Query;
+    QueryPending.store(true, std::memory_order_seq_cst);
+    WakeAggregator();
+    QueryAnswered.wait(Lock, [] { return !QueryPending.load(std::memory_order_relaxed); });
+    return QueryReply;
+}
+
+/* Single-producer/single-consumer ring between the emulation thread and
+ * the aggregator thread. Head and tail are free-running counters. */
+static const uint32 RING_SIZE = 1 << 16;
+
+static STraceEvent Ring[RING_SIZE];
+alignas(64) static std::atomic<uint32> RingHead(0);    // Written by the emulation thread.
+alignas(64) static std::atomic<uint32> RingTail(0);    // Written by the aggregator thread.
+alignas(64) static uint32 ProducerHead;                 // Emulation thread's copy of RingHead.
+static uint32 ProducerTail;                             // Last RingTail seen by the emulation thread.
+
+static std::thread* Aggregator;
+static std::atomic<bool> AggregatorStopping;    // Exit once the ring is empty.
+
+/* The aggregator sleeps while the ring is empty. It raises the flag before
+ * its last look at the ring, and the producer reads it after publishing an
+ * event, so one of the two always sees the other. The threads may still be
+ * asleep when the emulator exits without saving, and destroying a condition
+ * variable waits for its sleepers: it's left alone. */
+static std::mutex AggregatorMutex;
+static std::condition_variable& AggregatorWake = *new std::condition_variable;
+static std::atomic<bool> AggregatorSleeping(false);
+static uint32 LastInstruction;      // Index + 1 of the last traced instruction.
+
+uint64 GilgameshCycleBase;
+uint32 GilgameshPendingCount;
+uint32 GilgameshPendingCycles;
+
+/* Search instruction by PC.
+ * - If it's already present, fetch it.
+ * - Otherwise, create an "empty" instruction with the given PC.
+ * Then decode the instruction, unless nothing it depends on has changed. */
+static SInstruction& TraceInstruction(ProcessorType Processor, const SInstructionEvent& E)
+{
+    SProcessorTrace& P = Processors[Processor];
+
+    uint32 Count = P.Instructions.size();
+    SInstruction& I = P.FindInstruction(E.PC);
+    uint8 Opcode = I.Opcode;
+    uint8 Flags = I.Flags;
+    int Operand = I.Operand;
+
+    if (I.IsCached(E))
+        I.Flags = E.P;
+    else if (Processor == PROCESSOR_SPC700)
+        I.DecodeSPC700(E, P.NewReferences);
+    else
+        I.Decode(E, P.NewReferences);
+
+    if (P.Instructions.size() != Count || I.Opcode != Opcode || I.Flags != Flags || I.Operand != Operand)
+        P.MarkDirty(I);
+
+    return I;
+}
+
+static void Aggregate(const STraceEvent& Event)
+{
+    SProcessorTrace& Main = Processors[PROCESSOR_CPU];
+
+    switch (Event.Type)
+    {
+        case EVENT_INSTRUCTION:
+        {
+            const SInstructionEvent& E = Event.Instruction;
+
+            if (E.PrevCount && LastInstruction)
+            {
+                SInstruction& Previous = Main.Instructions[LastInstruction - 1];
+                Previous.Executions += E.PrevCount;
+                Previous.Cycles += E.PrevCycles;
+                Main.MarkDirty(Previous);
+            }
+
+            SInstruction& I = TraceInstruction(PROCESSOR_CPU, E);
+            LastInstruction = &I - Main.Instructions.data() + 1;
+            if (I.TriggersDMA)
+                DMALastPC = E.PC;
+
+            TraceCalls(E);
+            if (ExecLogActive)
+                LogExecution(E);
+            break;
+        }
+
+        case EVENT_SA1_INSTRUCTION:
+            TraceInstruction(PROCESSOR_SA1, Event.Instruction);
+            break;
+
+        case EVENT_SPC700_INSTRUCTION:
+            TraceInstruction(PROCESSOR_SPC700, Event.Instruction);
+            break;
+
+        case EVENT_VECTOR:
+        {
+            const SVectorEvent& V = Event.Vector;
+            SProcessorTrace& P = Processors[V.Processor];
+
+            // The call graph only follows the main CPU:
+            if (V.Processor == PROCESSOR_CPU)
+                TraceInterrupt(V);
+
+            auto Result = P.Vectors.emplace(V.PC, V.Type);
+            if (Result.second || Result.first->second != V.Type)
+            {
+                Result.first->second = V.Type;
+                P.NewVectors.emplace_back(V.PC, V.Type);
+            }
+            break;
+        }
+
+        case EVENT_DMA:
+        {
+            SDMATransfer DMATransfer;
+            DMATransfer.pc          = DMALastPC;
+            DMATransfer.source      = Event.DMA.Source;
+            DMATransfer.bytes       = Event.DMA.Bytes;
+            DMATransfer.destination = Event.DMA.Destination;
+
+            if (DMATransfers.insert(DMATransfer).second)
+                NewDMATransfers.push_back(DMATransfer);
+            break;
+        }
+
+        case EVENT_FRAME:
+            SubmitExecBlock(false);
+            ExecFrame = Event.Frame.Frame;
+            ExecLogActive = Event.Frame.ExecLog;
+            break;
+
+        case EVENT_CHECKPOINT:
+            if (Event.Checkpoint.Close)
+                SubmitExecBlock(true);
+            Checkpoint(Event.Checkpoint.Close, Event.Checkpoint.Memory);
+            break;
+    }
+}
+
+static void AggregatorMain()
+{
+    uint32 Tail = RingTail.load(std::memory_order_relaxed);
+    ExecLogActive = Settings.GilgameshExecLog;
+
+    for (;;)
+    {
+        // Read first, so that the head read after it is the final one:
+        bool Stopping = AggregatorStopping.load(std::memory_order_acquire);
+        uint32 Head = RingHead.load(std::memory_order_acquire);
+        if (Head == Tail)
+        {
+            if (Stopping)
+                return;
+            if (QueryPending.load(std::memory_order_acquire))
+            {
+                AnswerQuery();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> Lock(AggregatorMutex);
+            AggregatorSleeping.store(true, std::memory_order_seq_cst);
+            AggregatorWake.wait(Lock, [Tail] {
+                return RingHead.load(std::memory_order_seq_cst) != Tail ||
+                       AggregatorStopping.load(std::memory_order_seq_cst) ||
+                       QueryPending.load(std::memory_order_seq_cst);
+            });
+            AggregatorSleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Hand slots back in batches, so a full ring drains progressively.
+        while (Tail != Head)
+        {
+            uint32 Batch = std::min<uint32>(Head - Tail, 1024);
+            for (uint32 i = 0; i < Batch; i++)
+                Aggregate(Ring[(Tail + i) & (RING_SIZE - 1)]);
+
+            Tail += Batch;
+            RingTail.store(Tail, std::memory_order_release);
+
+            if (QueryPending.load(std::memory_order_acquire))
+                AnswerQuery();
+        }
+    }
+}
+
+static void StartAggregator()
+{
+    if (Aggregator == NULL)
+    {
+        AggregatorStopping.store(false, std::memory_order_relaxed);
+        Aggregator = new std::thread(AggregatorMain);
+    }
+}
+
+static inline STraceEvent& ReserveEvent()
+{
+    StartAggregator();
+
+    // Ring full: wait for the aggregator to catch up.
+    while (ProducerHead - ProducerTail == RING_SIZE)
+    {
+        ProducerTail = RingTail.load(std::memory_order_acquire);
+        if (ProducerHead - ProducerTail == RING_SIZE)
+            std::this_thread::yield();
+    }
+
+    return Ring[ProducerHead & (RING_SIZE - 1)];
+}
+
+static void WakeAggregator()
+{
+    std::lock_guard<std::mutex> Lock(AggregatorMutex);
+    AggregatorWake.notify_one();
+}
+
+// Publishes the event, waking the aggregator if the ring was empty.
+static inline void CommitEvent()
+{
+    RingHead.store(++ProducerHead, std::memory_order_seq_cst);
+    if (AggregatorSleeping.load(std::memory_order_seq_cst))
+        WakeAggregator();
+}
+
+// Wait until every event produced so far has been aggregated, and stop the aggregator.
+static void GilgameshFlush()
+{
+    if (Aggregator == NULL)
+        return;
+
+    AggregatorStopping.store(true, std::memory_order_seq_cst);
+    WakeAggregator();
+    Aggregator->join();
+    delete Aggregator;
+    Aggregator = NULL;
+}
+
+// Address of the memory an indirect addressing mode reads its pointer from.
+template<typename TRegisters>
+static uint32 PointerAddress(uint8 Mode, const uint8* Operands, const TRegisters& R)
+{
+    uint16 Operand = (Operands[1] << 8) | Operands[0];
+
+    switch (Mode)
+    {
+        case 10:
+            return Operands[0] + R.D.W + R.X.W;
+        case 20:
+            return Operands[0] + R.S.W;
+        case 21:
+        case 22:
+            return Operand;
+        case 23:
+            return (R.PB << 16) | ((Operand + R.X.W) & 0xFFFF);
+        default:
+            return Operands[0] + R.D.W;
+    }
+}
+
+/* Trace filter, on the emulation thread. Ranges are expanded to one bit per
+ * address of the banks they touch, so that filtering costs a lookup. */
+SGilgameshFilter GilgameshFilter = { true, 0, UINT32_MAX, 1, {} };
+bool GilgameshTracing = true;
+bool GilgameshActive = true;
+
+static uint8* FilterBits[0x100];    // NULL: no address of the bank is traced.
+static bool FilterRanges;           // Whether FilterBits is in use.
+static uint32 SampleCountdown = 1;
+
+/* Instructions filtered out since the last trace (a gap) are profiled
+ * apart, so that the profile of the last trace is held until the next. */
+static bool InGap;
+static uint32 HeldCount;
+static uint32 HeldCycles;
+
+// Frames out of the window run untraced, so the gap's cycles are timed apart:
+static uint64 UntracedSince;
+static uint64 UntracedCycles;
+
+static inline bool Filtered(uint8 Bank, uint16 Address)
+{
+    if (!GilgameshTracing)
+        return true;
+
+    if (FilterRanges)
+    {
+        const uint8* Bits = FilterBits[Bank];
+        if (Bits == NULL || !(Bits[Address >> 3] & (1 << (Address & 7))))
+            return true;
+    }
+
+    if (--SampleCountdown)
+        return true;
+    SampleCountdown = GilgameshFilter.Sampling;
+    return false;
+}
+
+static void StartGap()
+{
+    if (!GilgameshActive)
+        return;
+
+    InGap = true;
+    HeldCount  = GilgameshPendingCount;
+    HeldCycles = GilgameshPendingCycles;
+    GilgameshPendingCount  = 0;
+    GilgameshPendingCycles = 0;
+    GilgameshActive = false;
+}
+
+// Like S9xDebugGetByte, for the SA-1 memory map: no side effects on I/O registers.
+static uint8 SA1DebugGetByte(uint32 Address)
+{
+    if (SA1.Map[(Address & 0xFFFFFF) >> MEMMAP_SHIFT] == (uint8*) CMemory::MAP_PPU)
+        return 0;
+    return S9xSA1GetByte(Address);
+}
+
+/* Shared by both 65C816 cores, which only differ in registers and memory map.
+ * SRegisters and SSA1Registers have the same layout but are distinct types. */
+template<typename TRegisters>
+static void Trace65816(EventType Type, uint8 Bank, uint16 Address, const TRegisters& R,
+                       uint8* const* Map, uint8 (*DebugGetByte)(uint32))
+{
+    STraceEvent& Event = ReserveEvent();
+    SInstructionEvent& E = Event.Instruction;
+
+    Event.Type = Type;
+    E.PC = (Bank << 16) | Address;
+    E.P  = R.P.B.l;
+    E.DB = R.DB;
+    E.D  = R.D.W;
+    E.X  = R.X.W;
+    E.Y  = R.Y.W;
+    E.A  = R.A.W;
+    E.S  = R.S.W;
+
+    // Read straight from the memory map when the instruction doesn't cross a block:
+    uint8* Base = Map[(E.PC & 0xFFFFFF) >> MEMMAP_SHIFT];
+    if (Base >= (uint8*) CMemory::MAP_LAST && (E.PC & MEMMAP_MASK) <= MEMMAP_BLOCK_SIZE - 4)
+        memcpy(E.Bytes, Base + Address, 4);
+    else
+        for (int i = 0; i < 4; i++)
+            E.Bytes[i] = DebugGetByte(E.PC + i);
+
+    uint8 Mode = AddrModes[E.Bytes[0]];
+    if (DecodeInputs[Mode] & INPUT_MEMORY)
+    {
+        uint32 Pointer = PointerAddress(Mode, E.Bytes + 1, R);
+        for (int i = 0; i < 3; i++)
+            E.Pointer[i] = DebugGetByte(Pointer + i);
+    }
+
+    E.AfterGap = false;
+    E.GapCycles = 0;
+    if (Type == EVENT_INSTRUCTION)
+    {
+        GilgameshPC = E.PC;
+        E.PrevCount  = GilgameshPendingCount;
+        E.PrevCycles = GilgameshPendingCycles;
+        if (InGap)
+        {
+            // The pending profile is the gap's, the previous trace's was put aside:
+            E.AfterGap   = true;
+            E.PrevCount  = HeldCount;
+            E.PrevCycles = HeldCycles;
+            E.GapCycles  = GilgameshPendingCycles + UntracedCycles;
+            UntracedCycles = 0;
+            InGap = false;
+        }
+        GilgameshPendingCount  = 0;
+        GilgameshPendingCycles = 0;
+    }
+    else
+    {
+        E.PrevCount  = 0;
+        E.PrevCycles = 0;
+    }
+
+    CommitEvent();
+}
+
+void GilgameshTrace(uint8 Bank, uint16 Address)
+{
+    if (Filtered(Bank, Address))
+    {
+        StartGap();
+        return;
+    }
+
+    GilgameshActive = true;
+    Trace65816(EVENT_INSTRUCTION, Bank, Address, Registers, Memory.Map, S9xDebugGetByte);
+}
+
+void GilgameshTraceSA1(uint8 Bank, uint16 Address)
+{
+    Trace65816(EVENT_SA1_INSTRUCTION, Bank, Address, SA1Registers, SA1.Map, SA1DebugGetByte);
+}
+
+// Called by the SPC700 core before every opcode, with its 64 KiB of RAM.
+void GilgameshTraceSPC700(const uint8* SPCRAM, uint16 PC, uint16 DP, uint8 X, uint8 Y)
+{
+    STraceEvent& Event = ReserveEvent();
+    SInstructionEvent& E = Event.Instruction;
+
+    Event.Type = EVENT_SPC700_INSTRUCTION;
+    E.PC = PC;
+    E.P  = DP >> 3;     // The P flag.
+    E.DB = 0;
+    E.D  = DP;
+    E.X  = X;
+    E.Y  = Y;
+    E.A  = 0;
+    E.S  = 0;
+    E.AfterGap   = false;
+    E.PrevCount  = 0;
+    E.PrevCycles = 0;
+    E.GapCycles  = 0;
+
+    for (int i = 0; i < 4; i++)
+        E.Bytes[i] = SPCRAM[(PC + i) & 0xFFFF];
+
+    uint8 Mode = SPC700AddrModes[E.Bytes[0]];
+    if (SPC700DecodeInputs[Mode] & INPUT_MEMORY)
+    {
+        uint16 Pointer;
+        switch (Mode)
+        {
+            case 8:
+                Pointer = DP + ((E.Bytes[1] + X) & 0xFF);
+                break;
+            case 9:
+                Pointer = DP + E.Bytes[1];
+                break;
+            case 18:
+                Pointer = ((E.Bytes[2] << 8) | E.Bytes[1]) + X;
+                break;
+            default:
+                Pointer = 0xFFDE - ((E.Bytes[0] >> 4) << 1);
+                break;
+        }
+        E.Pointer[0] = SPCRAM[Pointer];
+        E.Pointer[1] = SPCRAM[(uint16) (Pointer + 1)];
+        E.Pointer[2] = 0;
+    }
+
+    CommitEvent();
+}
+
+void GilgameshTraceVector(uint32 PC, VectorType Type, ProcessorType Processor)
+{
+    if (!GilgameshTracing)
+        return;
+
+    STraceEvent& Event = ReserveEvent();
+
+    Event.Type = EVENT_VECTOR;
+    Event.Vector.PC = PC;
+    Event.Vector.Type = Type;
+    Event.Vector.Processor = Processor;
+    Event.Vector.Dispatched = GilgameshPendingCount != 0 || InGap;
+
+    CommitEvent();
+}
+
+void GilgameshTraceDMA(SDMA& DMA)
+{
+    // Only log incrementing CPU -> PPU stuff for now:
+    if (!GilgameshActive || DMA.ReverseTransfer || DMA.TransferMode > 2 || DMA.AAddressFixed || DMA.AAddressDecrement)
+        return;
+
+    STraceEvent& Event = ReserveEvent();
+
+    // The PC that triggered the transfer is only known after aggregation.
+    Event.Type = EVENT_DMA;
+    Event.DMA.Source = (unsigned) ((DMA.ABank << 16) | DMA.AAddress);
+    Event.DMA.Bytes  = (unsigned) DMA.TransferBytes;
+
+    switch (DMA.BAddress)
     {
-        SInstruction& I = KeyValue.second;
+        // VRAM:
+        case 0x18:
+        case 0x19:
+            Event.DMA.Destination = DMA_VRAM;
+            break;
 
-        if (I.Operand != UNDEFINED)
-            SQL("INSERT INTO instructions VALUES(%u, %u, %u, %d)", I.PC, I.Opcode, I.Flags, I.Operand);
-        else
-            SQL("INSERT INTO instructions VALUES(%u, %u, %u, NULL)", I.PC, I.Opcode, I.Flags);
+        // CGRAM:
+        case 0x22:
+            Event.DMA.Destination = DMA_CGRAM;
+            break;
+
+        // OBJADDR:
+        case 0x04:
+            Event.DMA.Destination = DMA_OAM;
+            break;
+    }
+
+    CommitEvent();
+}
+
+static void RequestCheckpoint(bool Close)
+{
+    STraceEvent& Event = ReserveEvent();
+
+    Event.Type = EVENT_CHECKPOINT;
+    Event.Checkpoint.Close = Close;
+    Event.Checkpoint.Memory = CopyDirtyPages();
+
+    CommitEvent();
+    WakeAggregator();
+}
+
+/* Two-tier tracing: a session with a replay interval records a movie of
+ * its input, and a snapshot every so many frames. -replay later re-runs a
+ * window of its frames, from the closest snapshot, with the execution log. */
+static uint32 SessionFrames;
+static bool SnapshotDue;
+static bool ReplayDone;
+
+static std::string LogPath(const char* Name)
+{
+    return std::string(S9xGetDirectory(LOG_DIR)) + "/" + Name;
+}
+
+// Frames are counted by the movie when there is one, so that replays agree.
+static uint32 CurrentFrame()
+{
+    return S9xMovieActive() ? S9xMovieGetFrameCounter() : SessionFrames;
+}
+
+static void StartFrame(uint32 Frame, bool ExecLog)
+{
+    STraceEvent& Event = ReserveEvent();
+
+    Event.Type = EVENT_FRAME;
+    Event.Frame.Frame = Frame;
+    Event.Frame.ExecLog = ExecLog;
+
+    CommitEvent();
+}
+
+static void UpdateTracing()
+{
+    uint32 Frame = CurrentFrame();
+    bool Tracing = GilgameshFilter.Enabled && Frame >= GilgameshFilter.FirstFrame && Frame <= GilgameshFilter.LastFrame;
+
+    if (!Tracing)
+    {
+        StartGap();
+        if (GilgameshTracing)
+            UntracedSince = GilgameshCycleBase + CPU.Cycles;
+    }
+    else if (!GilgameshTracing)
+        UntracedCycles += GilgameshCycleBase + CPU.Cycles - UntracedSince;
+    GilgameshTracing = Tracing;
+}
+
+void GilgameshApplyFilter()
+{
+    for (int Bank = 0; Bank < 0x100; Bank++)
+    {
+        delete[] FilterBits[Bank];
+        FilterBits[Bank] = NULL;
+    }
+
+    for (const auto& Range : GilgameshFilter.Ranges)
+    {
+        for (uint32 PC = Range.first; PC <= std::min<uint32>(Range.second, 0xFFFFFF); PC++)
+        {
+            uint8*& Bits = FilterBits[PC >> 16];
+            if (Bits == NULL)
+                Bits = new uint8[0x10000 >> 3]();
+            Bits[(PC & 0xFFFF) >> 3] |= 1 << (PC & 7);
+        }
+    }
+
+    FilterRanges = !GilgameshFilter.Ranges.empty();
+    if (GilgameshFilter.LastFrame == 0)
+        GilgameshFilter.LastFrame = UINT32_MAX;
+    GilgameshFilter.Sampling = std::max<uint32>(GilgameshFilter.Sampling, 1);
+    SampleCountdown = 1;
+    UpdateTracing();
+}
+
+// Appends ranges like "$00:8000-$00:FFFF" or "$7E:2000", separated by commas or spaces.
+bool GilgameshParseRanges(const char* Ranges)
+{
+    for (;;)
+    {
+        while (*Ranges == ' ' || *Ranges == ',')
+            Ranges++;
+        if (*Ranges == '\0')
+            return true;
+
+        uint32 First, Last;
+        if (!ParseRange(Ranges, First, Last))
+            return false;
+        GilgameshFilter.Ranges.emplace_back(First, Last);
+    }
+}
+
+// The latest snapshot of the session at or before Frame, if any.
+static bool FindSnapshot(uint32 Frame, uint32& Found)
+{
+    DIR* Directory = opendir(S9xGetDirectory(LOG_DIR));
+    if (Directory == NULL)
+        return false;
+
+    bool Any = false;
+    while (struct dirent* Entry = readdir(Directory))
+    {
+        unsigned Snapshot;
+        int Length = 0;
+        if (sscanf(Entry->d_name, "gilgamesh.%u.frz%n", &Snapshot, &Length) == 1 &&
+            Entry->d_name[Length] == '\0' && Snapshot <= Frame && (!Any || Snapshot > Found))
+        {
+            Found = Snapshot;
+            Any = true;
+        }
+    }
+    closedir(Directory);
+
+    return Any;
+}
+
+/* The query server: one client at a time, each line a query for the
+ * processor last selected with "cpu", "sa1" or "spc700". Every answer
+ * ends with an empty line. */
+static int QueryListener = -1;
+static std::mutex QueryClientMutex;     // Guards QueryClient and QueryStopping.
+static int QueryClient = -1;
+static bool QueryStopping;
+static std::thread* QueryServer;
+static std::string QuerySocketPath;
+
+static void ServeQueries(int Client)
+{
+    ProcessorType Processor = PROCESSOR_CPU;
+    std::string Buffer;
+    char Chunk[256];
+    ssize_t Length;
+
+    while ((Length = read(Client, Chunk, sizeof(Chunk))) > 0)
+    {
+        Buffer.append(Chunk, Length);
+
+        size_t End;
+        while ((End = Buffer.find('\n')) != std::string::npos)
+        {
+            std::string Query = Buffer.substr(0, End);
+            Buffer.erase(0, End + 1);
+            if (!Query.empty() && Query.back() == '\r')
+                Query.pop_back();
+
+            std::string Reply = "ok\n";
+            if (Query == "quit")
+                return;
+            else if (Query == "cpu")
+                Processor = PROCESSOR_CPU;
+            else if (Query == "sa1")
+                Processor = PROCESSOR_SA1;
+            else if (Query == "spc700")
+                Processor = PROCESSOR_SPC700;
+            else
+                Reply = AskAggregator(Processor, Query);
+            Reply += "\n";
+
+            for (size_t Sent = 0; Sent < Reply.size(); )
+            {
+                ssize_t Count = send(Client, Reply.data() + Sent, Reply.size() - Sent, MSG_NOSIGNAL);
+                if (Count <= 0)
+                    return;
+                Sent += Count;
+            }
+        }
+    }
+}
+
+static void QueryServerMain()
+{
+    for (;;)
+    {
+        int Client = accept(QueryListener, NULL, NULL);
+        if (Client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+
+        bool Stopping;
+        {
+            std::lock_guard<std::mutex> Lock(QueryClientMutex);
+            Stopping = QueryStopping;
+            if (!Stopping)
+                QueryClient = Client;
+        }
+        if (!Stopping)
+            ServeQueries(Client);
+
+        {
+            std::lock_guard<std::mutex> Lock(QueryClientMutex);
+            QueryClient = -1;
+        }
+        close(Client);
+    }
+}
+
+static bool StartQueryServer()
+{
+    QuerySocketPath = LogPath("gilgamesh.sock");
+
+    sockaddr_un Address = {};
+    Address.sun_family = AF_UNIX;
+    if (QuerySocketPath.size() >= sizeof(Address.sun_path))
+    {
+        fprintf(stderr, "Query socket path too long: %s\n", QuerySocketPath.c_str());
+        return false;
+    }
+    strcpy(Address.sun_path, QuerySocketPath.c_str());
+
+    QueryListener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(Address.sun_path);
+    if (QueryListener < 0 || bind(QueryListener, (sockaddr*) &Address, sizeof(Address)) < 0 || listen(QueryListener, 1) < 0)
+    {
+        fprintf(stderr, "Cannot listen on %s: %s\n", QuerySocketPath.c_str(), strerror(errno));
+        if (QueryListener >= 0)
+            close(QueryListener);
+        QueryListener = -1;
+        return false;
+    }
+
+    // Queries are answered by the aggregator, so it has to be running.
+    StartAggregator();
+    QueryServer = new std::thread(QueryServerMain);
+    return true;
+}
+
+static void StopQueryServer()
+{
+    if (QueryServer == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> Lock(QueryClientMutex);
+        QueryStopping = true;
+        if (QueryClient >= 0)
+            shutdown(QueryClient, SHUT_RDWR);
+    }
+    shutdown(QueryListener, SHUT_RDWR);
+
+    QueryServer->join();
+    delete QueryServer;
+    QueryServer = NULL;
+
+    close(QueryListener);
+    QueryListener = -1;
+    unlink(QuerySocketPath.c_str());
+}
+
+bool GilgameshStartSession()
+{
+    uint32 Flags = CPU.Flags & (DEBUG_MODE_FLAG | TRACE_FLAG);
+    std::string Movie = LogPath("gilgamesh.smv");
+
+    if (Settings.GilgameshReplay)
+    {
+        if (Settings.GilgameshReplayFirst > Settings.GilgameshReplayLast)
+        {
+            fprintf(stderr, "No frames to replay from %u to %u\n",
+                    (unsigned) Settings.GilgameshReplayFirst, (unsigned) Settings.GilgameshReplayLast);
+            return false;
+        }
+
+        if (S9xMovieOpen(Movie.c_str(), TRUE) != SUCCESS)
+        {
+            fprintf(stderr, "Cannot replay %s\n", Movie.c_str());
+            return false;
+        }
+
+        uint32 Snapshot = 0;
+        if (FindSnapshot(Settings.GilgameshReplayFirst, Snapshot) &&
+            !S9xUnfreezeGame(LogPath(("gilgamesh." + std::to_string(Snapshot) + ".frz").c_str()).c_str()))
+            return false;
+
+        // Add to the coverage of the session, at full speed:
+        Settings.GilgameshTrace = TRUE;
+        Settings.GilgameshMerge = TRUE;
+        Settings.GilgameshExecLog = FALSE;
+        Settings.TurboMode = TRUE;
+        uint32 Frame = CurrentFrame();
+        Settings.HighSpeedSeek = Frame <= Settings.GilgameshReplayLast ? Settings.GilgameshReplayLast + 1 - Frame : 0;
+        StartFrame(Frame, Frame >= Settings.GilgameshReplayFirst);
+    }
+    else if (Settings.GilgameshReplayInterval && !S9xMovieActive())
+    {
+        if (S9xMovieCreate(Movie.c_str(), 0xFF, MOVIE_OPT_FROM_SNAPSHOT, NULL, 0) != SUCCESS)
+        {
+            fprintf(stderr, "Cannot record %s\n", Movie.c_str());
+            return false;
+        }
+    }
+
+    GilgameshFilter.Enabled = Settings.GilgameshTrace;
+    GilgameshFilter.FirstFrame = Settings.GilgameshFirstFrame;
+    GilgameshFilter.LastFrame = Settings.GilgameshLastFrame;
+    GilgameshFilter.Sampling = Settings.GilgameshSampling;
+    GilgameshApplyFilter();
+
+    if (Settings.GilgameshQuerySocket && !StartQueryServer())
+        return false;
+
+    // Exiting without saving must not tear the tables down under the aggregator.
+    atexit(GilgameshFlush);
+
+    CPU.Flags |= Flags;
+    return true;
+}
+
+// Called between frames, where the machine state can be snapshotted.
+void GilgameshFrameEnd()
+{
+    if (SnapshotDue)
+    {
+        SnapshotDue = false;
+        S9xFreezeGame(LogPath(("gilgamesh." + std::to_string(CurrentFrame()) + ".frz").c_str()).c_str());
+    }
+
+    if (ReplayDone)
+    {
+        GilgameshSave();
+        S9xExit();
+    }
+}
+
+void GilgameshFrame()
+{
+    typedef std::chrono::steady_clock Clock;
+    static uint32 Frames;
+    static Clock::time_point LastCheckpoint = Clock::now();
+
+    SessionFrames++;
+    UpdateTracing();
+    uint32 Frame = CurrentFrame();
+    bool ExecLog = Settings.GilgameshExecLog;
+
+    if (Settings.GilgameshReplay)
+    {
+        ExecLog = Frame >= Settings.GilgameshReplayFirst && Frame <= Settings.GilgameshReplayLast;
+        ReplayDone = Frame > Settings.GilgameshReplayLast || !S9xMovieActive();
+    }
+    else if (Settings.GilgameshReplayInterval && S9xMovieActive() && Frame % Settings.GilgameshReplayInterval == 0)
+        SnapshotDue = true;
+
+    // Nothing traced yet:
+    if (Aggregator == NULL)
+        return;
+
+    if (Settings.GilgameshExecLog || Settings.GilgameshReplay)
+        StartFrame(Frame, ExecLog);
+
+    Clock::time_point Now = Clock::now();
+    bool Due = false;
+    if (Settings.GilgameshCheckpointFrames && ++Frames >= Settings.GilgameshCheckpointFrames)
+        Due = true;
+    if (Settings.GilgameshCheckpointSeconds && Now - LastCheckpoint >= std::chrono::seconds(Settings.GilgameshCheckpointSeconds))
+        Due = true;
+
+    if (Due)
+    {
+        Frames = 0;
+        LastCheckpoint = Now;
+        RequestCheckpoint(false);
+    }
+}
+
+void GilgameshSave()
+{
+    StopQueryServer();
+    RequestCheckpoint(true);
+    GilgameshFlush();
+
+    // The writer exits once the final checkpoint is on disk.
+    std::thread* FinishedWriter;
+    {
+        std::lock_guard<std::mutex> Lock(WriterMutex);
+        FinishedWriter = Writer;
+        Writer = NULL;
+    }
+    FinishedWriter->join();
+    delete FinishedWriter;
+
+    // Likewise for the execution log, if it ever got a block.
+    std::thread* FinishedExecLogWriter;
+    {
+        std::lock_guard<std::mutex> Lock(ExecLogMutex);
+        FinishedExecLogWriter = ExecLogWriter;
+        ExecLogWriter = NULL;
+    }
+    if (FinishedExecLogWriter != NULL)
+    {
+        FinishedExecLogWriter->join();
+        delete FinishedExecLogWriter;
+    }
+}
+
+static bool OpenDatabase()
+{
+    std::string DatabasePath = S9xGetDirectory(LOG_DIR);
+    DatabasePath += "/gilgamesh.db";
+
+    int Status = sqlite3_open(DatabasePath.c_str(), &Database);
+    if (Status != SQLITE_OK)
+    {
+        fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(Database));
+        sqlite3_close(Database);
+        Database = NULL;
+        return false;
+    }
+
+    // WAL, so that the database can be read while checkpoints go in.
+    return SQLExec("PRAGMA journal_mode = WAL")       == SQLITE_OK &&
+           SQLExec("PRAGMA synchronous = NORMAL")     == SQLITE_OK &&
+           SQLExec("PRAGMA cache_size = -65536")      == SQLITE_OK &&
+           SQLExec("PRAGMA temp_store = MEMORY")      == SQLITE_OK;
+}
+
+/* Exclusive cycles per call path, in the folded format of Brendan Gregg's
+ * flamegraph.pl: one "outer;...;inner cycles" line per path. */
+static void WriteFoldedStacks(const std::vector<SPathNode>& Nodes)
+{
+    static const char* const KindNames[] = { "reset", "nmi", "irq", "sub" };
+
+    std::string Path = S9xGetDirectory(LOG_DIR);
+    Path += "/gilgamesh.folded";
+    std::string TemporaryPath = Path + ".tmp";
+
+    FILE* File = fopen(TemporaryPath.c_str(), "w");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", TemporaryPath.c_str());
+        return;
+    }
+
+    std::vector<uint32> Stack;
+    for (uint32 i = 0; i < Nodes.size(); i++)
+    {
+        if (Nodes[i].Cycles == 0)
+            continue;
+
+        Stack.clear();
+        for (uint32 Node = i; Node != NO_NODE; Node = Nodes[Node].Parent)
+            Stack.push_back(Node);
+
+        for (auto Node = Stack.rbegin(); Node != Stack.rend(); ++Node)
+            fprintf(File, "%s%s_%06X", Node == Stack.rbegin() ? "" : ";", KindNames[Nodes[*Node].Kind], Nodes[*Node].Entry);
+        fprintf(File, " %llu\n", (unsigned long long) Nodes[i].Cycles);
+    }
+
+    fclose(File);
+    rename(TemporaryPath.c_str(), Path.c_str());
+}
+
+// Whether the database holds a previous trace of the loaded ROM.
+static bool SameROM()
+{
+    sqlite3_stmt* Statement;
+    bool Same = false;
+
+    if (sqlite3_prepare_v2(Database, "SELECT crc32 FROM rom", -1, &Statement, NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step(Statement) == SQLITE_ROW)
+            Same = (uint32) sqlite3_column_int64(Statement, 0) == Memory.ROMCRC32;
+        sqlite3_finalize(Statement);
+    }
+
+    return Same;
+}
+
+// The shadow memory as of the last checkpoint, to only write the bytes that changed.
+static std::vector<uint32> ExportedWriters[3];
+static std::vector<uint32> ExportedReaders[3];
+static std::vector<uint8>  ExportedAccess[3];
+
+static bool WriteMemory(const std::vector<SShadowPage>& Pages)
+{
+    SStatement InsertMemory;
+    if (!InsertMemory.Prepare("INSERT INTO memory VALUES(?, ?, ?, ?, ?) ON CONFLICT(space, address) DO UPDATE SET "
+                              "writer = COALESCE(excluded.writer, writer), "
+                              "reader = COALESCE(reader, excluded.reader), "
+                              "access = access | excluded.access"))
+        return false;
+
+    for (const SShadowPage& P: Pages)
+    {
+        std::vector<uint32>& Writers = ExportedWriters[P.Space];
+        std::vector<uint32>& Readers = ExportedReaders[P.Space];
+        std::vector<uint8>&  Access  = ExportedAccess[P.Space];
+        if (Access.empty())
+        {
+            Writers.resize(GilgameshShadow[P.Space].Size);
+            Readers.resize(GilgameshShadow[P.Space].Size);
+            Access.resize(GilgameshShadow[P.Space].Size);
+        }
+
+        for (uint32 i = 0; i < SHADOW_PAGE_SIZE; i++)
+        {
+            uint32 Address = P.Offset + i;
+            if (P.Access[i] == Access[Address] && P.Writers[i] == Writers[Address] && P.Readers[i] == Readers[Address])
+                continue;
+            Writers[Address] = P.Writers[i];
+            Readers[Address] = P.Readers[i];
+            Access[Address]  = P.Access[i];
+
+            InsertMemory.Bind(1, P.Space);
+            InsertMemory.Bind(2, Address);
+            if (P.Access[i] & ACCESS_WRITES)
+                InsertMemory.Bind(3, P.Writers[i]);
+            else
+                InsertMemory.BindNull(3);
+            if (P.Access[i] & ACCESS_READS)
+                InsertMemory.Bind(4, P.Readers[i]);
+            else
+                InsertMemory.BindNull(4);
+            InsertMemory.Bind(5, P.Access[i]);
+            if (!InsertMemory.Step())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// The main CPU keeps the original table names; coprocessors get their own tables.
+static const char* const TablePrefixes[PROCESSOR_COUNT] = { "", "sa1_", "spc700_" };
+
+// The SPC700 has no interrupts, and always resets into the IPL ROM.
+static bool HasVectors(int Processor)
+{
+    return Processor != PROCESSOR_SPC700;
+}
+
+// Everything in one transaction, which an error rolls back by closing the database.
+static bool WriteTables(const SCheckpoint& C)
+{
+    /* The first checkpoint of the session starts the tables from scratch,
+     * unless merging into a trace of the same ROM: then every row is
+     * upserted into what previous sessions left. */
+    bool Create = !SchemaCreated && !(Settings.GilgameshMerge && SameROM());
+
+    SQL("BEGIN TRANSACTION");
+    if (Create)
+    {
+        SQL("DROP TABLE IF EXISTS rom");
+        SQL("CREATE TABLE rom(crc32 INTEGER NOT NULL)");
+        {
+            SStatement InsertROM;
+            if (!InsertROM.Prepare("INSERT INTO rom VALUES(?)") || !InsertROM.Insert(Memory.ROMCRC32))
+                return false;
+        }
 
-        for (int DirectReference: I.References)
-            SQL("INSERT INTO references_ VALUES(%d, %d, %d)", I.PC, DirectReference, DIRECT_REFERENCE);
-        for (int IndirectReference: I.IndirectReferences)
-            SQL("INSERT INTO references_ VALUES(%d, %d, %d)", I.PC, IndirectReference, INDIRECT_REFERENCE);
+        SQL("DROP TABLE IF EXISTS instructions");
+        SQL("CREATE TABLE instructions(pc      INTEGER PRIMARY KEY,"
+                                      "opcode  INTEGER NOT NULL,"
+                                      "flags   INTEGER NOT NULL,"
+                                      "operand INTEGER)");
+
+        /* The composite keys are created as unique indexes once the first
+         * batch of rows is in, which is much cheaper than maintaining them
+         * on every insert. */
+        SQL("DROP TABLE IF EXISTS references_");
+        SQL("CREATE TABLE references_(pointer INTEGER,"
+                                     "pointee INTEGER,"
+                                     "type    INTEGER)");
+
+        SQL("DROP TABLE IF EXISTS dma");
+        SQL("CREATE TABLE dma(pc          INTEGER,"
+                             "source      INTEGER,"
+                             "destination INTEGER,"
+                             "bytes       INTEGER)");
+
+        SQL("DROP TABLE IF EXISTS vectors");
+        SQL("CREATE TABLE vectors(pc   INTEGER PRIMARY KEY,"
+                                 "type INTEGER NOT NULL)");
+
+        SQL("DROP TABLE IF EXISTS profile");
+        SQL("DROP TABLE IF EXISTS calls");
+        SQL("DROP TABLE IF EXISTS memory");
+
+        for (int Processor = PROCESSOR_SA1; Processor < PROCESSOR_COUNT; Processor++)
+        {
+            std::string Prefix = TablePrefixes[Processor];
+            SQL(("DROP TABLE IF EXISTS " + Prefix + "instructions").c_str());
+            SQL(("DROP TABLE IF EXISTS " + Prefix + "references_").c_str());
+            SQL(("DROP TABLE IF EXISTS " + Prefix + "vectors").c_str());
+        }
+    }
+    // Same layout as the main CPU tables. Merged databases may predate them:
+    for (int Processor = PROCESSOR_SA1; Processor < PROCESSOR_COUNT; Processor++)
+    {
+        std::string Prefix = TablePrefixes[Processor];
+        SQL(("CREATE TABLE IF NOT EXISTS " + Prefix + "instructions(pc      INTEGER PRIMARY KEY,"
+                                                                     "opcode  INTEGER NOT NULL,"
+                                                                     "flags   INTEGER NOT NULL,"
+                                                                     "operand INTEGER)").c_str());
+        SQL(("CREATE TABLE IF NOT EXISTS " + Prefix + "references_(pointer INTEGER,"
+                                                                    "pointee INTEGER,"
+                                                                    "type    INTEGER)").c_str());
+        if (HasVectors(Processor))
+            SQL(("CREATE TABLE IF NOT EXISTS " + Prefix + "vectors(pc   INTEGER PRIMARY KEY,"
+                                                                "type INTEGER NOT NULL)").c_str());
+    }
+    // Merged databases may predate the profile:
+    SQL("CREATE TABLE IF NOT EXISTS profile(pc         INTEGER PRIMARY KEY,"
+                                           "executions INTEGER NOT NULL,"
+                                           "cycles     INTEGER NOT NULL)");
+    // The caller of the outermost frame is -1.
+    SQL("CREATE TABLE IF NOT EXISTS calls(caller    INTEGER NOT NULL,"
+                                         "callee    INTEGER NOT NULL,"
+                                         "calls     INTEGER NOT NULL,"
+                                         "inclusive INTEGER NOT NULL,"
+                                         "exclusive INTEGER NOT NULL,"
+                                         "PRIMARY KEY (caller, callee))");
+    // Space is a MemorySpace, access a mask of ACCESS_* bits.
+    SQL("CREATE TABLE IF NOT EXISTS memory(space   INTEGER NOT NULL,"
+                                          "address INTEGER NOT NULL,"
+                                          "writer  INTEGER,"
+                                          "reader  INTEGER,"
+                                          "access  INTEGER NOT NULL,"
+                                          "PRIMARY KEY (space, address))");
+    if (!WriteMemory(C.Memory))
+        return false;
+    {
+        SStatement InsertDMA, InsertProfile, InsertCall;
+        if (!InsertProfile.Prepare("INSERT INTO profile VALUES(?, ?, ?) ON CONFLICT(pc) DO UPDATE SET "
+                                   "executions = executions + excluded.executions, "
+                                   "cycles = cycles + excluded.cycles") ||
+            !InsertCall.Prepare("INSERT INTO calls VALUES(?, ?, ?, ?, ?) ON CONFLICT(caller, callee) DO UPDATE SET "
+                                "calls = calls + excluded.calls, "
+                                "inclusive = inclusive + excluded.inclusive, "
+                                "exclusive = exclusive + excluded.exclusive") ||
+            !InsertDMA.Prepare("INSERT OR IGNORE INTO dma VALUES(?, ?, ?, ?)"))
+            return false;
+
+        for (int Processor = 0; Processor < PROCESSOR_COUNT; Processor++)
+        {
+            std::string Prefix = TablePrefixes[Processor];
+            SStatement InsertInstruction, InsertReference, InsertVector;
+            if (!InsertInstruction.Prepare(("INSERT OR REPLACE INTO " + Prefix + "instructions VALUES(?, ?, ?, ?)").c_str()) ||
+                !InsertReference.Prepare(("INSERT OR IGNORE INTO " + Prefix + "references_ VALUES(?, ?, ?)").c_str()) ||
+                (HasVectors(Processor) &&
+                 !InsertVector.Prepare(("INSERT OR REPLACE INTO " + Prefix + "vectors VALUES(?, ?)").c_str())))
+                return false;
+
+            for (const SInstructionRow& I: C.Instructions[Processor])
+            {
+                InsertInstruction.Bind(1, I.PC);
+                InsertInstruction.Bind(2, I.Opcode);
+                InsertInstruction.Bind(3, I.Flags);
+                if (I.Operand != UNDEFINED)
+                    InsertInstruction.Bind(4, I.Operand);
+                else
+                    InsertInstruction.BindNull(4);
+                if (!InsertInstruction.Step())
+                    return false;
+
+                // Only the main CPU is profiled.
+                if (I.Executions && !InsertProfile.Insert(I.PC, I.Executions, I.Cycles))
+                    return false;
+            }
+            for (const SReferenceRow& R: C.References[Processor])
+            {
+                if (!InsertReference.Insert(R.Pointer, R.Pointee, R.Type))
+                    return false;
+            }
+            for (auto& KeyValue: C.Vectors[Processor])
+            {
+                if (!InsertVector.Insert(KeyValue.first, KeyValue.second))
+                    return false;
+            }
+        }
+        for (const SDMATransfer& DMATransfer: C.DMATransfers)
+        {
+            if (!InsertDMA.Insert(DMATransfer.pc, DMATransfer.source, DMATransfer.destination, DMATransfer.bytes))
+                return false;
+        }
+        for (const SCallRow& Call: C.Calls)
+        {
+            if (!InsertCall.Insert(Call.Caller, Call.Callee, Call.Edge.Calls, Call.Edge.Inclusive, Call.Edge.Exclusive))
+                return false;
+        }
     }
-    for (auto& DMATransfer: DMATransfers)
+    if (Create)
     {
-        SQL("INSERT INTO dma VALUES(%d, %d, %d, %d)",
-            DMATransfer.pc, DMATransfer.source, DMATransfer.destination, DMATransfer.bytes);
+        SQL("CREATE UNIQUE INDEX references_key ON references_(pointer, pointee, type)");
+        SQL("CREATE UNIQUE INDEX dma_key ON dma(pc, source, destination, bytes)");
     }
-    for (auto& KeyValue: Vectors)
+    for (int Processor = PROCESSOR_SA1; Processor < PROCESSOR_COUNT; Processor++)
     {
-        uint32 PC = KeyValue.first;
-        VectorType Type = KeyValue.second;
-        SQL("INSERT INTO vectors VALUES(%d, %d)", PC, Type);
+        std::string Prefix = TablePrefixes[Processor];
+        SQL(("CREATE UNIQUE INDEX IF NOT EXISTS " + Prefix + "references_key ON " +
+             Prefix + "references_(pointer, pointee, type)").c_str());
     }
     SQL("COMMIT TRANSACTION");
+    return true;
+}
+
+static bool WriteCheckpoint(const SCheckpoint& C)
+{
+    if (Database == NULL && !OpenDatabase())
+        return false;
 
-    sqlite3_close(Database);
+    if (!WriteTables(C))
+    {
+        // The memory rows of the failed checkpoint get written again, in full.
+        for (int Space = 0; Space < 3; Space++)
+        {
+            ExportedWriters[Space].clear();
+            ExportedReaders[Space].clear();
+            ExportedAccess[Space].clear();
+        }
+        return false;
+    }
+    SchemaCreated = true;
+
+    WriteFoldedStacks(C.PathNodes);
+
+    // Fold the WAL back into the database, so that it stands on its own.
+    if (C.Close && Database != NULL)
+    {
+        SQLExec("PRAGMA wal_checkpoint(TRUNCATE)");
+        sqlite3_close_v2(Database);
+        Database = NULL;
+    }
+    return true;
 }
 
 #endif
@@ -3,8 +3,17 @@
 #ifndef _GILGAMESH_H_
 #define _GILGAMESH_H_
 
+#include <utility>
+#include <vector>
 #include "dma.h"
 
+enum ProcessorType
+{
+    PROCESSOR_CPU = 0,
+    PROCESSOR_SA1 = 1,
+    PROCESSOR_SPC700 = 2
+};
+
 enum VectorType
 {
     VECTOR_RESET = 0,
@@ -19,9 +28,108 @@ enum DMADestinationType
     DMA_OAM = 2
 };
 
+/* What to trace, from the configuration or the debugger. Changes take
+ * effect with GilgameshApplyFilter. */
+struct SGilgameshFilter
+{
+    bool   Enabled;
+    uint32 FirstFrame;      // Window of frames to trace, inclusive.
+    uint32 LastFrame;       // 0 for no end.
+    uint32 Sampling;        // Trace one main CPU instruction in Sampling.
+    std::vector<std::pair<uint32, uint32> > Ranges;     // Main CPU PCs to trace,
+};                                                      // inclusive. None: all.
+
+extern SGilgameshFilter GilgameshFilter;
+
+/* Whether this frame is traced: S9xMainLoop runs without any tracing code
+ * while it's not, and the coprocessors skip theirs. Within a traced frame,
+ * GilgameshActive tells whether the current instruction passed the filter:
+ * memory accesses and DMA are only traced for those. */
+extern bool GilgameshTracing;
+extern bool GilgameshActive;
+
+/* Profiling: S9xMainLoop adds the master cycles of every dispatched
+ * opcode to the pending count, and the next trace claims them. The base
+ * accumulates the cycles of past scanlines, since CPU.Cycles wraps. */
+extern uint64 GilgameshCycleBase;
+extern uint32 GilgameshPendingCount;
+extern uint32 GilgameshPendingCycles;
+
+/* Shadow memory: for every byte of WRAM, SRAM and VRAM, the PC of the last
+ * instruction that wrote it, of the first one that read it, and the kinds
+ * of access it has seen. Plain arrays, so it's cheap enough to leave on. */
+enum MemorySpace
+{
+    MEMORY_WRAM = 0,
+    MEMORY_SRAM = 1,
+    MEMORY_VRAM = 2
+};
+
+enum
+{
+    ACCESS_READ      = 1,
+    ACCESS_WRITE     = 2,
+    ACCESS_DMA_READ  = ACCESS_READ << 2,    // Accesses by (H)DMA, on behalf
+    ACCESS_DMA_WRITE = ACCESS_WRITE << 2,   // of the instruction that started it.
+    ACCESS_READS     = ACCESS_READ | ACCESS_DMA_READ,
+    ACCESS_WRITES    = ACCESS_WRITE | ACCESS_DMA_WRITE
+};
+
+static const int SHADOW_PAGE_SHIFT = 8;
+
+struct SShadowMemory
+{
+    uint32* Writers;        // Valid where Access has ACCESS_WRITES.
+    uint32* Readers;        // Valid where Access has ACCESS_READS.
+    uint8*  Access;
+    uint8*  DirtyPages;     // Pages changed since the last checkpoint.
+    uint32  Size;
+};
+
+extern uint32 GilgameshPC;  // PC of the last traced instruction.
+extern uint32 GilgameshHDMAPC;  // PC of the instruction that last wrote HDMAEN.
+extern SShadowMemory GilgameshShadow[3];
+
+// Kind is ACCESS_READ or ACCESS_WRITE; InDMA turns it into its DMA variant.
+static inline void GilgameshAccess(MemorySpace Space, uint32 Offset, uint8 Kind, bool InDMA)
+{
+    if (!GilgameshActive)
+        return;
+
+    SShadowMemory& Shadow = GilgameshShadow[Space];
+    uint8 Seen = Shadow.Access[Offset];
+
+    if (InDMA)
+        Kind <<= 2;
+
+    if (Kind & ACCESS_WRITES)
+    {
+        if ((Seen & Kind) && Shadow.Writers[Offset] == GilgameshPC)
+            return;
+        Shadow.Writers[Offset] = GilgameshPC;
+    }
+    else
+    {
+        if (Seen & Kind)
+            return;
+        if (!(Seen & ACCESS_READS))
+            Shadow.Readers[Offset] = GilgameshPC;
+    }
+
+    Shadow.Access[Offset] = Seen | Kind;
+    Shadow.DirtyPages[Offset >> SHADOW_PAGE_SHIFT] = 1;
+}
+
+void GilgameshApplyFilter();
+bool GilgameshParseRanges(const char* Ranges);
+bool GilgameshStartSession();
+void GilgameshFrame();
+void GilgameshFrameEnd();
 void GilgameshSave();
 void GilgameshTrace(uint8 Bank, uint16 Address);
-void GilgameshTraceVector(uint32 PC, VectorType Type);
+void GilgameshTraceSA1(uint8 Bank, uint16 Address);
+void GilgameshTraceSPC700(const uint8* SPCRAM, uint16 PC, uint16 DP, uint8 X, uint8 Y);
+void GilgameshTraceVector(uint32 PC, VectorType Type, ProcessorType Processor);
 void GilgameshTraceDMA(SDMA& DMA);
 
 #endif
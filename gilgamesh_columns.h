@@ -0,0 +1,63 @@
+/* Columnar export of the trace, for tools that load whole tables.
+ *
+ * gilgamesh.columns is written when the session closes, from the same
+ * in-memory tables as the database, so it holds what this session traced
+ * (not what -merge added to the database from earlier ones). It starts with
+ * an SColumnsHeader, followed by the columns it points to. Every column is
+ * an array of fixed-size values, 8-byte aligned, so a tool can mmap the file
+ * and index the columns directly, with no parsing.
+ *
+ * For every processor:
+ *   - Instructions, sorted by PC: PC (uint32), Opcode (uint8), Flags
+ *     (uint8), Operand (int32, -1 if none), Executions and Cycles (uint64).
+ *   - References of instruction i, sorted by pointee, are those from
+ *     ReferenceStart[i] to ReferenceStart[i + 1] (uint32, InstructionCount
+ *     + 1 of them) in Pointee (int32) and ReferenceType (uint8, 0 direct,
+ *     1 indirect).
+ *   - The same references sorted by pointee, then pointer, for reverse
+ *     lookups: ByPointee (int32) and ByPointeeInstruction (uint32, index of
+ *     the referencing instruction).
+ *
+ * Multi-byte values are little-endian, whatever the host: the header and
+ * the columns are written value by value, not copied from memory. */
+
+#ifndef _GILGAMESH_COLUMNS_H_
+#define _GILGAMESH_COLUMNS_H_
+
+#include <stdint.h>
+
+#define COLUMNS_MAGIC "GILGCOLS"
+
+static const uint32_t COLUMNS_VERSION = 1;
+static const uint32_t COLUMNS_PROCESSORS = 3;  // CPU, SA-1, SPC700.
+
+// File offsets of the columns of one processor.
+struct SColumnsTable
+{
+    uint64_t InstructionCount;
+    uint64_t ReferenceCount;
+
+    uint64_t PC;
+    uint64_t Opcode;
+    uint64_t Flags;
+    uint64_t Operand;
+    uint64_t Executions;
+    uint64_t Cycles;
+
+    uint64_t ReferenceStart;
+    uint64_t Pointee;
+    uint64_t ReferenceType;
+
+    uint64_t ByPointee;
+    uint64_t ByPointeeInstruction;
+};
+
+struct SColumnsHeader
+{
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t ROMCRC32;
+    SColumnsTable Tables[COLUMNS_PROCESSORS];
+};
+
+#endif
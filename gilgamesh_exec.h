@@ -0,0 +1,297 @@
+/* Binary execution log of the main CPU, shared by the emulator and the tools.
+ *
+ * gilgamesh.exec holds every traced instruction with the registers it ran
+ * with. It starts with an SExecLogHeader, followed by blocks: an
+ * SExecBlockHeader, then the records of the block, deflated (or stored
+ * as is when CompressedSize is 0). Every frame starts a new block, and so
+ * do frames too long for a single one.
+ *
+ * Records are delta-encoded against the previous record of the same block:
+ *   - Mask: EXEC_* bits of what follows.
+ *   - PC: 3 bytes if EXEC_JUMP, else 1 byte of distance from the previous PC.
+ *   - Opcode: 1 byte.
+ *   - Cycles since the previous record, as a LEB128 varint.
+ *   - P, DB (1 byte each), D, A, X, Y, S (2 bytes each), only when in Mask.
+ * The first record of a block has every bit of Mask set, so that decoding
+ * can start at any block.
+ *
+ * gilgamesh.exec.idx starts with an SExecIndexHeader, followed by the file
+ * offset (uint64) of the first block of every frame from FirstFrame on:
+ * tools can mmap both files and seek to frame N directly. Frames are those
+ * of the movie when one is playing or recording, so that a replay of the
+ * session numbers them the same.
+ *
+ * Multi-byte values are little-endian, headers and index offsets included:
+ * they are written field by field with the Exec*Header functions below, so
+ * the files read the same on any host. */
+
+#ifndef _GILGAMESH_EXEC_H_
+#define _GILGAMESH_EXEC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EXEC_LOG_MAGIC   "GILGEXEC"
+#define EXEC_INDEX_MAGIC "GILGEIDX"
+
+static const uint32_t EXEC_LOG_VERSION = 2;
+
+// Serialized sizes of the headers.
+static const uint32_t EXEC_LOG_HEADER_SIZE   = 16;
+static const uint32_t EXEC_INDEX_HEADER_SIZE = 16;
+static const uint32_t EXEC_BLOCK_HEADER_SIZE = 24;
+
+// Largest encoded record: mask, PC, opcode, 5-byte varint and every register.
+static const uint32_t EXEC_MAX_RECORD = 1 + 3 + 1 + 5 + 2 + 2 * 5;
+
+struct SExecLogHeader
+{
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t ROMCRC32;
+};
+
+struct SExecIndexHeader
+{
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t FirstFrame;        // Frame of the first offset.
+};
+
+struct SExecBlockHeader
+{
+    uint32_t CompressedSize;    // 0 if stored uncompressed.
+    uint32_t RawSize;
+    uint32_t Frame;
+    uint32_t Records;
+    uint64_t Cycles;            // Cycles executed before the first record.
+};
+
+enum
+{
+    EXEC_P    = 1 << 0,
+    EXEC_DB   = 1 << 1,
+    EXEC_D    = 1 << 2,
+    EXEC_A    = 1 << 3,
+    EXEC_X    = 1 << 4,
+    EXEC_Y    = 1 << 5,
+    EXEC_S    = 1 << 6,
+    EXEC_JUMP = 1 << 7,
+    EXEC_KEYFRAME = 0xFF
+};
+
+// Registers before an instruction runs.
+struct SExecState
+{
+    uint32_t PC;
+    uint8_t  Opcode;
+    uint8_t  P;
+    uint8_t  DB;
+    uint16_t D;
+    uint16_t A;
+    uint16_t X;
+    uint16_t Y;
+    uint16_t S;
+    uint32_t Cycles;            // Since the previous record.
+};
+
+static inline uint8_t* ExecPutWord(uint8_t* Out, uint16_t Value)
+{
+    Out[0] = Value;
+    Out[1] = Value >> 8;
+    return Out + 2;
+}
+
+static inline const uint8_t* ExecGetWord(const uint8_t* In, uint16_t& Value)
+{
+    Value = In[0] | (In[1] << 8);
+    return In + 2;
+}
+
+static inline uint8_t* ExecPutLong(uint8_t* Out, uint32_t Value)
+{
+    Out = ExecPutWord(Out, Value);
+    return ExecPutWord(Out, Value >> 16);
+}
+
+static inline const uint8_t* ExecGetLong(const uint8_t* In, uint32_t& Value)
+{
+    uint16_t Low, High;
+    In = ExecGetWord(In, Low);
+    In = ExecGetWord(In, High);
+    Value = Low | ((uint32_t) High << 16);
+    return In;
+}
+
+static inline uint8_t* ExecPutQuad(uint8_t* Out, uint64_t Value)
+{
+    Out = ExecPutLong(Out, Value);
+    return ExecPutLong(Out, Value >> 32);
+}
+
+static inline const uint8_t* ExecGetQuad(const uint8_t* In, uint64_t& Value)
+{
+    uint32_t Low, High;
+    In = ExecGetLong(In, Low);
+    In = ExecGetLong(In, High);
+    Value = Low | ((uint64_t) High << 32);
+    return In;
+}
+
+static inline uint8_t* ExecPutLogHeader(uint8_t* Out, const SExecLogHeader& Header)
+{
+    memcpy(Out, Header.Magic, sizeof(Header.Magic));
+    Out = ExecPutLong(Out + sizeof(Header.Magic), Header.Version);
+    return ExecPutLong(Out, Header.ROMCRC32);
+}
+
+static inline const uint8_t* ExecGetLogHeader(const uint8_t* In, SExecLogHeader& Header)
+{
+    memcpy(Header.Magic, In, sizeof(Header.Magic));
+    In = ExecGetLong(In + sizeof(Header.Magic), Header.Version);
+    return ExecGetLong(In, Header.ROMCRC32);
+}
+
+static inline uint8_t* ExecPutIndexHeader(uint8_t* Out, const SExecIndexHeader& Header)
+{
+    memcpy(Out, Header.Magic, sizeof(Header.Magic));
+    Out = ExecPutLong(Out + sizeof(Header.Magic), Header.Version);
+    return ExecPutLong(Out, Header.FirstFrame);
+}
+
+static inline const uint8_t* ExecGetIndexHeader(const uint8_t* In, SExecIndexHeader& Header)
+{
+    memcpy(Header.Magic, In, sizeof(Header.Magic));
+    In = ExecGetLong(In + sizeof(Header.Magic), Header.Version);
+    return ExecGetLong(In, Header.FirstFrame);
+}
+
+static inline uint8_t* ExecPutBlockHeader(uint8_t* Out, const SExecBlockHeader& Header)
+{
+    Out = ExecPutLong(Out, Header.CompressedSize);
+    Out = ExecPutLong(Out, Header.RawSize);
+    Out = ExecPutLong(Out, Header.Frame);
+    Out = ExecPutLong(Out, Header.Records);
+    return ExecPutQuad(Out, Header.Cycles);
+}
+
+static inline const uint8_t* ExecGetBlockHeader(const uint8_t* In, SExecBlockHeader& Header)
+{
+    In = ExecGetLong(In, Header.CompressedSize);
+    In = ExecGetLong(In, Header.RawSize);
+    In = ExecGetLong(In, Header.Frame);
+    In = ExecGetLong(In, Header.Records);
+    return ExecGetQuad(In, Header.Cycles);
+}
+
+/* Appends Next to Out, given the previously encoded state (updated).
+ * Returns the new end of Out, at most EXEC_MAX_RECORD bytes further. */
+static inline uint8_t* ExecEncode(uint8_t* Out, SExecState& Previous, const SExecState& Next, bool Keyframe)
+{
+    uint8_t Mask = EXEC_KEYFRAME;
+    if (!Keyframe)
+    {
+        Mask = 0;
+        Mask |= Next.P  != Previous.P  ? EXEC_P  : 0;
+        Mask |= Next.DB != Previous.DB ? EXEC_DB : 0;
+        Mask |= Next.D  != Previous.D  ? EXEC_D  : 0;
+        Mask |= Next.A  != Previous.A  ? EXEC_A  : 0;
+        Mask |= Next.X  != Previous.X  ? EXEC_X  : 0;
+        Mask |= Next.Y  != Previous.Y  ? EXEC_Y  : 0;
+        Mask |= Next.S  != Previous.S  ? EXEC_S  : 0;
+        if ((Next.PC ^ Previous.PC) & 0xFF0000 || Next.PC < Previous.PC || Next.PC - Previous.PC > 0xFF)
+            Mask |= EXEC_JUMP;
+    }
+
+    *Out++ = Mask;
+    if (Mask & EXEC_JUMP)
+    {
+        *Out++ = Next.PC;
+        Out = ExecPutWord(Out, Next.PC >> 8);
+    }
+    else
+        *Out++ = Next.PC - Previous.PC;
+    *Out++ = Next.Opcode;
+
+    uint32_t Cycles = Next.Cycles;
+    while (Cycles >= 0x80)
+    {
+        *Out++ = Cycles | 0x80;
+        Cycles >>= 7;
+    }
+    *Out++ = Cycles;
+
+    if (Mask & EXEC_P)
+        *Out++ = Next.P;
+    if (Mask & EXEC_DB)
+        *Out++ = Next.DB;
+    if (Mask & EXEC_D)
+        Out = ExecPutWord(Out, Next.D);
+    if (Mask & EXEC_A)
+        Out = ExecPutWord(Out, Next.A);
+    if (Mask & EXEC_X)
+        Out = ExecPutWord(Out, Next.X);
+    if (Mask & EXEC_Y)
+        Out = ExecPutWord(Out, Next.Y);
+    if (Mask & EXEC_S)
+        Out = ExecPutWord(Out, Next.S);
+
+    Previous = Next;
+    return Out;
+}
+
+// Decodes the record at In over the previous state. Returns the next record,
+// or NULL if the record would run past End.
+static inline const uint8_t* ExecDecode(const uint8_t* In, const uint8_t* End, SExecState& State)
+{
+    if (End - In < 3)
+        return NULL;
+    uint8_t Mask = *In++;
+    if (Mask & EXEC_JUMP)
+    {
+        if (End - In < 4)
+            return NULL;
+        State.PC = In[0] | (In[1] << 8) | (In[2] << 16);
+        In += 3;
+    }
+    else
+        State.PC += *In++;
+    State.Opcode = *In++;
+
+    State.Cycles = 0;
+    for (int Shift = 0; ; Shift += 7)
+    {
+        if (In == End || Shift > 28)
+            return NULL;
+        uint8_t Byte = *In++;
+        State.Cycles |= (uint32_t) (Byte & 0x7F) << Shift;
+        if (!(Byte & 0x80))
+            break;
+    }
+
+    int Size = (Mask & EXEC_P  ? 1 : 0) + (Mask & EXEC_DB ? 1 : 0) +
+               (Mask & EXEC_D  ? 2 : 0) + (Mask & EXEC_A  ? 2 : 0) +
+               (Mask & EXEC_X  ? 2 : 0) + (Mask & EXEC_Y  ? 2 : 0) +
+               (Mask & EXEC_S  ? 2 : 0);
+    if (End - In < Size)
+        return NULL;
+
+    if (Mask & EXEC_P)
+        State.P = *In++;
+    if (Mask & EXEC_DB)
+        State.DB = *In++;
+    if (Mask & EXEC_D)
+        In = ExecGetWord(In, State.D);
+    if (Mask & EXEC_A)
+        In = ExecGetWord(In, State.A);
+    if (Mask & EXEC_X)
+        In = ExecGetWord(In, State.X);
+    if (Mask & EXEC_Y)
+        In = ExecGetWord(In, State.Y);
+    if (Mask & EXEC_S)
+        In = ExecGetWord(In, State.S);
+
+    return In;
+}
+
+#endif
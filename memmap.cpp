@@ -2639,6 +2639,229 @@ void CMemory::InitROM (void)
     S9xVerifyControllers();
 }
 
+// byte accessors of the blocks that aren't plain memory
+
+static uint8 get_None (uint32 Address)
+{
+	return (OpenBus);
+}
+
+static uint8 get_CPU (uint32 Address)
+{
+	return (S9xGetCPU(Address & 0xffff));
+}
+
+static uint8 get_PPU (uint32 Address)
+{
+	if (CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
+		return (OpenBus);
+
+	return (S9xGetPPU(Address & 0xffff));
+}
+
+static uint8 get_LoROMSRAM (uint32 Address)
+{
+	// Address & 0x7fff   : offset into bank
+	// Address & 0xff0000 : bank
+	// bank >> 1 | offset : SRAM address, unbound
+	// unbound & SRAMMask : SRAM offset
+	uint8	*byte = Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask);
+
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+	return (*byte);
+}
+
+static uint8 get_LoROMSRAM_B (uint32 Address)
+{
+	uint8	*byte = Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB);
+
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+	return (*byte);
+}
+
+static uint8 get_HiROMSRAM (uint32 Address)
+{
+	uint8	*byte = Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask);
+
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+	return (*byte);
+}
+
+static uint8 get_BWRAM (uint32 Address)
+{
+	uint8	*byte = Memory.BWRAM + ((Address & 0x7fff) - 0x6000);
+
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+	return (*byte);
+}
+
+static uint8 get_DSP (uint32 Address)
+{
+	return (S9xGetDSP(Address & 0xffff));
+}
+
+static uint8 get_SPC7110_DRAM (uint32 Address)
+{
+	return (S9xGetSPC7110(0x4800));
+}
+
+static uint8 get_C4 (uint32 Address)
+{
+	return (S9xGetC4(Address & 0xffff));
+}
+
+static uint8 get_OBC1 (uint32 Address)
+{
+	return (S9xGetOBC1(Address & 0xffff));
+}
+
+static void set_None (uint8 Byte, uint32 Address)
+{
+	return;
+}
+
+static void set_CPU (uint8 Byte, uint32 Address)
+{
+	S9xSetCPU(Byte, Address & 0xffff);
+}
+
+static void set_PPU (uint8 Byte, uint32 Address)
+{
+	if (CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
+		return;
+
+	S9xSetPPU(Byte, Address & 0xffff);
+}
+
+static void set_LoROMSRAM (uint8 Byte, uint32 Address)
+{
+	if (Memory.SRAMMask)
+	{
+		*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)) = Byte;
+		CPU.SRAMModified = TRUE;
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask), ACCESS_WRITE);
+	#endif
+	}
+}
+
+static void set_LoROMSRAM_B (uint8 Byte, uint32 Address)
+{
+	if (Multi.sramMaskB)
+	{
+		*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)) = Byte;
+		CPU.SRAMModified = TRUE;
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB), ACCESS_WRITE);
+	#endif
+	}
+}
+
+static void set_HiROMSRAM (uint8 Byte, uint32 Address)
+{
+	if (Memory.SRAMMask)
+	{
+		*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)) = Byte;
+		CPU.SRAMModified = TRUE;
+	#ifdef DEBUGGER
+		GilgameshAccessPointer(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask), ACCESS_WRITE);
+	#endif
+	}
+}
+
+static void set_BWRAM (uint8 Byte, uint32 Address)
+{
+	*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = Byte;
+	CPU.SRAMModified = TRUE;
+#ifdef DEBUGGER
+	GilgameshAccessPointer(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), ACCESS_WRITE);
+#endif
+}
+
+static void set_SA1RAM (uint8 Byte, uint32 Address)
+{
+	*(Memory.SRAM + (Address & 0xffff)) = Byte;
+#ifdef DEBUGGER
+	GilgameshAccessPointer(Memory.SRAM + (Address & 0xffff), ACCESS_WRITE);
+#endif
+}
+
+static void set_DSP (uint8 Byte, uint32 Address)
+{
+	S9xSetDSP(Byte, Address & 0xffff);
+}
+
+static void set_C4 (uint8 Byte, uint32 Address)
+{
+	S9xSetC4(Byte, Address & 0xffff);
+}
+
+static void set_OBC1 (uint8 Byte, uint32 Address)
+{
+	S9xSetOBC1(Byte, Address & 0xffff);
+}
+
+// indexed by map type, in the order of CMemory::MAP_*
+uint8 (* const S9xGetByteHandlers[CMemory::MAP_LAST]) (uint32) =
+{
+	get_CPU,			// MAP_CPU
+	get_PPU,			// MAP_PPU
+	get_LoROMSRAM,		// MAP_LOROM_SRAM
+	get_LoROMSRAM_B,	// MAP_LOROM_SRAM_B
+	get_HiROMSRAM,		// MAP_HIROM_SRAM
+	get_DSP,			// MAP_DSP
+	get_LoROMSRAM,		// MAP_SA1RAM
+	get_BWRAM,			// MAP_BWRAM
+	get_None,			// MAP_BWRAM_BITMAP
+	get_None,			// MAP_BWRAM_BITMAP2
+	S9xGetSPC7110Byte,	// MAP_SPC7110_ROM
+	get_SPC7110_DRAM,	// MAP_SPC7110_DRAM
+	get_HiROMSRAM,		// MAP_RONLY_SRAM
+	get_C4,				// MAP_C4
+	get_OBC1,			// MAP_OBC_RAM
+	S9xGetSetaDSP,		// MAP_SETA_DSP
+	S9xGetST018,		// MAP_SETA_RISC
+	S9xGetBSX,			// MAP_BSX
+	S9xGetSuperFXRAM,	// MAP_SUPERFX_RAM
+	S9xGetSA1Shared,	// MAP_SA1_SHARED
+	get_None,			// MAP_NONE
+	get_None			// MAP_WATCH, handled by the callers
+};
+
+void (* const S9xSetByteHandlers[CMemory::MAP_LAST]) (uint8, uint32) =
+{
+	set_CPU,			// MAP_CPU
+	set_PPU,			// MAP_PPU
+	set_LoROMSRAM,		// MAP_LOROM_SRAM
+	set_LoROMSRAM_B,	// MAP_LOROM_SRAM_B
+	set_HiROMSRAM,		// MAP_HIROM_SRAM
+	set_DSP,			// MAP_DSP
+	set_SA1RAM,			// MAP_SA1RAM
+	set_BWRAM,			// MAP_BWRAM
+	set_None,			// MAP_BWRAM_BITMAP
+	set_None,			// MAP_BWRAM_BITMAP2
+	set_None,			// MAP_SPC7110_ROM
+	set_None,			// MAP_SPC7110_DRAM
+	set_None,			// MAP_RONLY_SRAM
+	set_C4,				// MAP_C4
+	set_OBC1,			// MAP_OBC_RAM
+	S9xSetSetaDSP,		// MAP_SETA_DSP
+	S9xSetST018,		// MAP_SETA_RISC
+	S9xSetBSX,			// MAP_BSX
+	S9xSetSuperFXRAM,	// MAP_SUPERFX_RAM
+	S9xSetSA1Shared,	// MAP_SA1_SHARED
+	set_None,			// MAP_NONE
+	set_None			// MAP_WATCH, handled by the callers
+};
+
 // memory map
 
 uint32 CMemory::map_mirror (uint32 size, uint32 pos)
@@ -2872,6 +3095,18 @@ void CMemory::map_WriteProtectROM (void)
 	}
 }
 
+void CMemory::map_Speed (void)
+{
+	// depends on CPU.FastROMSpeed, so MEMSEL writes rebuild it
+	for (int c = 0; c < 0x1000; c++)
+	{
+		if ((c & 0x40f) == 0x004)
+			BlockSpeed[c] = 0;
+		else
+			BlockSpeed[c] = memory_speed(c << MEMMAP_SHIFT);
+	}
+}
+
 void CMemory::Map_Initialize (void)
 {
 	for (int c = 0; c < 0x1000; c++)
@@ -2881,6 +3116,8 @@ void CMemory::Map_Initialize (void)
 		BlockIsROM[c] = FALSE;
 		BlockIsRAM[c] = FALSE;
 	}
+
+	map_Speed();
 }
 
 void CMemory::Map_LoROMMap (void)
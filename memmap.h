@@ -218,7 +218,10 @@ struct CMemory
 		MAP_SETA_DSP,
 		MAP_SETA_RISC,
 		MAP_BSX,
+		MAP_SUPERFX_RAM,
+		MAP_SA1_SHARED,
 		MAP_NONE,
+		MAP_WATCH,
 		MAP_LAST
 	};
 
@@ -240,6 +243,7 @@ struct CMemory
 	uint8	*WriteMap[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsRAM[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsROM[MEMMAP_NUM_BLOCKS];
+	uint8	BlockSpeed[MEMMAP_NUM_BLOCKS];
 	uint8	ExtendedFormat;
 
 	char	ROMFilename[PATH_MAX + 1];
@@ -305,6 +309,7 @@ struct CMemory
 	void	map_SetaRISC (void);
 	void	map_SetaDSP (void);
 	void	map_WriteProtectROM (void);
+	void	map_Speed (void);
 	void	Map_Initialize (void);
 	void	Map_LoROMMap (void);
 	void	Map_NoMAD1LoROMMap (void);
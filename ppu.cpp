@@ -196,6 +196,13 @@
 
 extern uint8	*HDMAMemPointers[8];
 
+#ifdef DEBUGGER
+static uint32	VRAMReadAddress;	// Where IPPU.VRAMReadBuffer was prefetched from.
+#define READ_VRAM_WORD(address)	READ_WORD(Memory.VRAM + (VRAMReadAddress = (address)))
+#else
+#define READ_VRAM_WORD(address)	READ_WORD(Memory.VRAM + (address))
+#endif
+
 
 static inline void S9xLatchCounters (bool force)
 {
@@ -267,6 +274,7 @@ void S9xUpdateHVTimerPosition (void)
 	}
 
 	PPU.VTimerPosition = PPU.IRQVBeamPos;
+	CPU.NextCheck = 0;
 
 	if ((PPU.HTimerPosition >= Timings.H_Max) && (PPU.IRQHBeamPos < 340))
 	{
@@ -627,10 +635,10 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 					uint32 addr = PPU.VMA.Address;
 					uint32 rem = addr & PPU.VMA.Mask1;
 					uint32 address = (addr & ~PPU.VMA.Mask1) + (rem >> PPU.VMA.Shift) + ((rem & (PPU.VMA.FullGraphicCount - 1)) << 3);
-					IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((address << 1) & 0xffff));
+					IPPU.VRAMReadBuffer = READ_VRAM_WORD((address << 1) & 0xffff);
 				}
 				else
-					IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((PPU.VMA.Address << 1) & 0xffff));
+					IPPU.VRAMReadBuffer = READ_VRAM_WORD((PPU.VMA.Address << 1) & 0xffff);
 
 				break;
 
@@ -643,10 +651,10 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 					uint32 addr = PPU.VMA.Address;
 					uint32 rem = addr & PPU.VMA.Mask1;
 					uint32 address = (addr & ~PPU.VMA.Mask1) + (rem >> PPU.VMA.Shift) + ((rem & (PPU.VMA.FullGraphicCount - 1)) << 3);
-					IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((address << 1) & 0xffff));
+					IPPU.VRAMReadBuffer = READ_VRAM_WORD((address << 1) & 0xffff);
 				}
 				else
-					IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((PPU.VMA.Address << 1) & 0xffff));
+					IPPU.VRAMReadBuffer = READ_VRAM_WORD((PPU.VMA.Address << 1) & 0xffff);
 
 				break;
 
@@ -1052,6 +1060,7 @@ void S9xSetPPU (uint8 Byte, uint16 Address)
 		else
 		if (Settings.SA1     && Address >= 0x2200)
 		{
+			S9xSA1Sync();
 			if (Address <= 0x23ff)
 				S9xSetSA1(Byte, Address);
 			else
@@ -1206,6 +1215,9 @@ uint8 S9xGetPPU (uint16 Address)
 
 			case 0x2139: // VMDATALREAD
 				byte = IPPU.VRAMReadBuffer & 0xff;
+			#ifdef DEBUGGER
+				GilgameshAccess(MEMORY_VRAM, VRAMReadAddress, ACCESS_READ, CPU.InDMAorHDMA);
+			#endif
 				if (!PPU.VMA.High)
 				{
 					if (PPU.VMA.FullGraphicCount)
@@ -1213,10 +1225,10 @@ uint8 S9xGetPPU (uint16 Address)
 						uint32 addr = PPU.VMA.Address;
 						uint32 rem = addr & PPU.VMA.Mask1;
 						uint32 address = (addr & ~PPU.VMA.Mask1) + (rem >> PPU.VMA.Shift) + ((rem & (PPU.VMA.FullGraphicCount - 1)) << 3);
-						IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((address << 1) & 0xffff));
+						IPPU.VRAMReadBuffer = READ_VRAM_WORD((address << 1) & 0xffff);
 					}
 					else
-						IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((PPU.VMA.Address << 1) & 0xffff));
+						IPPU.VRAMReadBuffer = READ_VRAM_WORD((PPU.VMA.Address << 1) & 0xffff);
 
 					PPU.VMA.Address += PPU.VMA.Increment;
 				}
@@ -1228,6 +1240,9 @@ uint8 S9xGetPPU (uint16 Address)
 
 			case 0x213a: // VMDATAHREAD
 				byte = (IPPU.VRAMReadBuffer >> 8) & 0xff;
+			#ifdef DEBUGGER
+				GilgameshAccess(MEMORY_VRAM, VRAMReadAddress + 1, ACCESS_READ, CPU.InDMAorHDMA);
+			#endif
 				if (PPU.VMA.High)
 				{
 					if (PPU.VMA.FullGraphicCount)
@@ -1235,10 +1250,10 @@ uint8 S9xGetPPU (uint16 Address)
 						uint32 addr = PPU.VMA.Address;
 						uint32 rem = addr & PPU.VMA.Mask1;
 						uint32 address = (addr & ~PPU.VMA.Mask1) + (rem >> PPU.VMA.Shift) + ((rem & (PPU.VMA.FullGraphicCount - 1)) << 3);
-						IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((address << 1) & 0xffff));
+						IPPU.VRAMReadBuffer = READ_VRAM_WORD((address << 1) & 0xffff);
 					}
 					else
-						IPPU.VRAMReadBuffer = READ_WORD(Memory.VRAM + ((PPU.VMA.Address << 1) & 0xffff));
+						IPPU.VRAMReadBuffer = READ_VRAM_WORD((PPU.VMA.Address << 1) & 0xffff);
 
 					PPU.VMA.Address += PPU.VMA.Increment;
 				}
@@ -1297,6 +1312,9 @@ uint8 S9xGetPPU (uint16 Address)
 			case 0x2180: // WMDATA
 				if (!CPU.InWRAMDMAorHDMA)
 				{
+				#ifdef DEBUGGER
+					GilgameshAccess(MEMORY_WRAM, PPU.WRAM, ACCESS_READ, CPU.InDMAorHDMA);
+				#endif
 					byte = Memory.RAM[PPU.WRAM++];
 					PPU.WRAM &= 0x1ffff;
 				}
@@ -1317,7 +1335,10 @@ uint8 S9xGetPPU (uint16 Address)
 			return (S9xGetSuperFX(Address));
 		else
 		if (Settings.SA1     && Address >= 0x2200)
+		{
+			S9xSA1Sync();
 			return (S9xGetSA1(Address));
+		}
 		else
 		if (Settings.BS      && Address >= 0x2188 && Address <= 0x219f)
 			return (S9xGetBSXPPU(Address));
@@ -1488,6 +1509,8 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 					CPU.IRQTransition = FALSE;
 				}
 
+				CPU.NextCheck = 0;
+
 				// NMI can trigger immediately during VBlank as long as NMI_read ($4210) wasn't cleard.
 				if ((Byte & 0x80) && !(Memory.FillRAM[0x4200] & 0x80) &&
 					(CPU.V_Counter >= PPU.ScreenHeight + FIRST_VISIBLE_LINE) && (Memory.FillRAM[0x4210] & 0x80))
@@ -1614,6 +1637,7 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 			#ifdef DEBUGGER
 				missing.hdma_this_frame |= Byte;
 				missing.hdma_channels |= Byte;
+				GilgameshHDMAPC = GilgameshPC;
 			#endif
 				break;
 
@@ -1629,6 +1653,8 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 					}
 					else
 						CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+
+					Memory.map_Speed();
 				}
 
 				break;
@@ -1758,6 +1784,7 @@ uint8 S9xGetCPU (uint16 Address)
 				byte = CPU.IRQLine ? 0x80 : 0;
 				CPU.IRQLine = FALSE;
 				CPU.IRQTransition = FALSE;
+				CPU.NextCheck = 0;
 				return (byte | (OpenBus & 0x7f));
 
 			case 0x4212: // HVBJOY
@@ -1882,6 +1909,7 @@ void S9xSoftResetPPU (void)
 	PPU.VTimerEnabled = FALSE;
 	PPU.HTimerPosition = Timings.H_Max + 1;
 	PPU.VTimerPosition = Timings.V_Max + 1;
+	CPU.NextCheck = 0;
 	PPU.IRQHBeamPos = 0x1ff;
 	PPU.IRQVBeamPos = 0x1ff;
 
@@ -382,6 +382,9 @@ void S9xDoAutoJoypad (void);
 
 #include "gfx.h"
 #include "memmap.h"
+#ifdef DEBUGGER
+#include "gilgamesh.h"
+#endif
 
 typedef struct
 {
@@ -527,6 +530,10 @@ static inline void REGISTER_2118 (uint8 Byte)
 	else
 		Memory.VRAM[address = (PPU.VMA.Address << 1) & 0xffff] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -564,6 +571,10 @@ static inline void REGISTER_2119 (uint8 Byte)
 	else
 		Memory.VRAM[address = ((PPU.VMA.Address << 1) + 1) & 0xffff] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -595,6 +606,10 @@ static inline void REGISTER_2118_tile (uint8 Byte)
 
 	Memory.VRAM[address] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -620,6 +635,10 @@ static inline void REGISTER_2119_tile (uint8 Byte)
 
 	Memory.VRAM[address] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -644,6 +663,10 @@ static inline void REGISTER_2118_linear (uint8 Byte)
 
 	Memory.VRAM[address = (PPU.VMA.Address << 1) & 0xffff] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -668,6 +691,10 @@ static inline void REGISTER_2119_linear (uint8 Byte)
 
 	Memory.VRAM[address = ((PPU.VMA.Address << 1) + 1) & 0xffff] = Byte;
 
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_VRAM, address, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
+
 	IPPU.TileCached[TILE_2BIT][address >> 4] = FALSE;
 	IPPU.TileCached[TILE_4BIT][address >> 5] = FALSE;
 	IPPU.TileCached[TILE_8BIT][address >> 6] = FALSE;
@@ -720,6 +747,9 @@ static inline void REGISTER_2122 (uint8 Byte)
 
 static inline void REGISTER_2180 (uint8 Byte)
 {
+#ifdef DEBUGGER
+	GilgameshAccess(MEMORY_WRAM, PPU.WRAM, ACCESS_WRITE, CPU.InDMAorHDMA);
+#endif
 	Memory.RAM[PPU.WRAM++] = Byte;
 	PPU.WRAM &= 0x1ffff;
 }
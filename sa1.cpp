@@ -181,6 +181,13 @@
 
 uint8	SA1OpenBus;
 
+// While the SA-1 runs behind, the S-CPU blocks of I-RAM and BW-RAM are
+// redirected to MAP_SA1_SHARED, so that the S-CPU, DMA and HDMA catch it up
+// (S9xSA1Sync) before touching them, as they do for $2200-$23ff.
+static int		SA1SharedBlock[MEMMAP_NUM_BLOCKS];
+static int		SA1SharedCount = 0;
+static uint8	*SA1SharedMap[MEMMAP_NUM_BLOCKS], *SA1SharedWriteMap[MEMMAP_NUM_BLOCKS];
+
 static void S9xSA1SetBWRAMMemMap (uint8);
 static void S9xSetSA1MemMap (uint32, uint8);
 static void S9xSA1CharConv2 (void);
@@ -194,6 +201,7 @@ void S9xSA1Init (void)
 	SA1.PrevCycles = 0;
 	SA1.Flags = 0;
 	SA1.WaitingForInterrupt = FALSE;
+	SA1.Behind = 0;
 
 	memset(&Memory.FillRAM[0x2200], 0, 0x200);
 	Memory.FillRAM[0x2200] = 0x20;
@@ -280,6 +288,7 @@ static void S9xSA1SetBWRAMMemMap (uint8 val)
 
 void S9xSA1PostLoadState (void)
 {
+	SA1.Behind = 0;
 	SA1.ShiftedPB = (uint32) SA1Registers.PB << 16;
 	SA1.ShiftedDB = (uint32) SA1Registers.DB << 16;
 
@@ -312,6 +321,118 @@ static void S9xSetSA1MemMap (uint32 which1, uint8 map)
 		for (int i = c + 8; i < c + 16; i++)
 			Memory.Map[start2 + i] = SA1.Map[start2 + i] = block;
 	}
+
+#ifdef DEBUGGER
+	S9xWatchMapChanged();
+#endif
+}
+
+// Whether the S-CPU block maps RAM the SA-1 writes to: I-RAM or BW-RAM.
+static bool8 S9xSA1Shares (int block)
+{
+	uint8	*map = Memory.Map[block];
+
+	if (map == (uint8 *) CMemory::MAP_BWRAM)
+		return (TRUE);
+
+	if (map < (uint8 *) CMemory::MAP_LAST)
+		return (FALSE);
+
+	map += (block & 0xf) << MEMMAP_SHIFT;
+	return ((size_t) (map - Memory.SRAM) < 0x20000 || (size_t) (map - (Memory.FillRAM + 0x3000)) < 0x800);
+}
+
+// Lets the SA-1 run behind the S-CPU, or catches it up and maps the shared
+// RAM back. Code in the shared RAM is fetched through MAP_SA1_SHARED too.
+void S9xSA1ShareRAM (bool8 share)
+{
+	int		pc = (Registers.PBPC & 0xffffff) >> MEMMAP_SHIFT;
+	bool8	pcShared = (Memory.Map[pc] == (uint8 *) CMemory::MAP_SA1_SHARED);
+
+	if (share == SA1.RunsBehind)
+		return;
+
+	if (share)
+	{
+		SA1SharedCount = 0;
+
+		for (int b = 0; b < MEMMAP_NUM_BLOCKS; b++)
+		{
+		#ifdef DEBUGGER
+			// watchpoints would see the RAM without catching the SA-1 up
+			if (Memory.Map[b] == (uint8 *) CMemory::MAP_WATCH || Memory.WriteMap[b] == (uint8 *) CMemory::MAP_WATCH)
+				return;
+		#endif
+			if (S9xSA1Shares(b))
+				SA1SharedBlock[SA1SharedCount++] = b;
+		}
+
+		for (int i = 0; i < SA1SharedCount; i++)
+		{
+			int	b = SA1SharedBlock[i];
+			SA1SharedMap[b] = Memory.Map[b];
+			SA1SharedWriteMap[b] = Memory.WriteMap[b];
+			Memory.Map[b] = Memory.WriteMap[b] = (uint8 *) CMemory::MAP_SA1_SHARED;
+		}
+	}
+	else
+	{
+		S9xSA1Sync();
+
+		for (int i = 0; i < SA1SharedCount; i++)
+		{
+			int	b = SA1SharedBlock[i];
+			Memory.Map[b] = SA1SharedMap[b];
+			Memory.WriteMap[b] = SA1SharedWriteMap[b];
+		}
+	}
+
+	SA1.RunsBehind = share;
+
+	if (pcShared || Memory.Map[pc] == (uint8 *) CMemory::MAP_SA1_SHARED)
+		S9xSetPCBase(Registers.PBPC);
+}
+
+// Catches the SA-1 up, and returns the original entry of a shared block.
+uint8 * S9xSA1SharedMap (uint32 address)
+{
+	S9xSA1Sync();
+	return (SA1SharedMap[(address & 0xffffff) >> MEMMAP_SHIFT]);
+}
+
+uint8 S9xGetSA1Shared (uint32 address)
+{
+	uint8	*map = S9xSA1SharedMap(address);
+
+	if (map < (uint8 *) CMemory::MAP_LAST)
+		return (S9xGetByteHandlers[(pint) map](address));
+
+	uint8	*byte = map + (address & 0xffff);
+#ifdef DEBUGGER
+	GilgameshAccessPointer(byte, ACCESS_READ);
+#endif
+
+	return (*byte);
+}
+
+void S9xSetSA1Shared (uint8 byte, uint32 address)
+{
+	S9xSA1Sync();
+
+	uint8	*map = SA1SharedWriteMap[(address & 0xffffff) >> MEMMAP_SHIFT];
+
+	if (map < (uint8 *) CMemory::MAP_LAST)
+	{
+		S9xSetByteHandlers[(pint) map](byte, address);
+		return;
+	}
+
+	uint8	*ptr = map + (address & 0xffff);
+#ifdef DEBUGGER
+	GilgameshAccessPointer(ptr, ACCESS_WRITE);
+#endif
+
+	*ptr = byte;
 }
 
 uint8 S9xGetSA1 (uint32 address)
@@ -399,6 +520,9 @@ void S9xSetSA1 (uint8 byte, uint32 address)
 				SA1Registers.PB = 0;
 				SA1Registers.PCw = Memory.FillRAM[0x2203] | (Memory.FillRAM[0x2204] << 8);
 				S9xSA1SetPCBase(SA1Registers.PBPC);
+			#ifdef DEBUGGER
+				GilgameshTraceVector(SA1Registers.PBPC, VECTOR_RESET, PROCESSOR_SA1);
+			#endif
 			}
 
 			// SA-1 IRQ control
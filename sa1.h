@@ -207,6 +207,8 @@ struct SSA1
 	int32	PrevCycles;
 	uint8	*PCBase;
 	bool8	WaitingForInterrupt;
+	uint32	Behind;			// S-CPU instructions the SA-1 has yet to follow
+	bool8	RunsBehind;		// the RAM it shares with the S-CPU is redirected to MAP_SA1_SHARED
 
 	uint8	*Map[MEMMAP_NUM_BLOCKS];
 	uint8	*WriteMap[MEMMAP_NUM_BLOCKS];
@@ -265,8 +267,27 @@ uint8 S9xGetSA1 (uint32);
 void S9xSetSA1 (uint8, uint32);
 void S9xSA1Init (void);
 void S9xSA1MainLoop (void);
+void S9xSA1CatchUp (void);
+void S9xSA1ShareRAM (bool8);
+uint8 * S9xSA1SharedMap (uint32);
+uint8 S9xGetSA1Shared (uint32);
+void S9xSetSA1Shared (uint8, uint32);
 void S9xSA1PostLoadState (void);
 
+// Runs the SA-1 up to the S-CPU, before the S-CPU touches what they share.
+static inline void S9xSA1Sync (void)
+{
+	if (SA1.Behind)
+		S9xSA1CatchUp();
+}
+
+// Whether the SA-1 may fall behind the S-CPU. It can't while it may
+// interrupt the S-CPU ($2201), nor while the shared RAM is mapped directly.
+static inline bool8 S9xSA1CanRunBehind (void)
+{
+	return (SA1.RunsBehind && !(Memory.FillRAM[0x2201] & 0xa0));
+}
+
 static inline void S9xSA1UnpackStatus (void)
 {
 	SA1._Zero = (SA1Registers.PL & Zero) == 0;
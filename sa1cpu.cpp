@@ -229,6 +229,15 @@
 static void S9xSA1UpdateTimer (void);
 
 
+void S9xSA1CatchUp (void)
+{
+	while (SA1.Behind)
+	{
+		SA1.Behind--;
+		S9xSA1MainLoop();
+	}
+}
+
 void S9xSA1MainLoop (void)
 {
 	if (Memory.FillRAM[0x2200] & 0x60)
@@ -298,11 +307,27 @@ void S9xSA1MainLoop (void)
 		}
 	}
 
+	// SA-1 sitting on WAI: the three opcodes below would only re-execute it
+	if (SA1.WaitingForInterrupt && SA1.PCBase && SA1.PCBase[SA1Registers.PCw] == 0xcb &&
+		(SA1Registers.PCw & MEMMAP_MASK) + 1 < MEMMAP_BLOCK_SIZE
+	#ifdef DEBUGGER
+		&& !(SA1.Flags & TRACE_FLAG) && !GilgameshTracing
+	#endif
+		)
+	{
+		SA1OpenBus = 0xcb;
+		SA1.Cycles += 3 * TWO_CYCLES;
+		S9xSA1UpdateTimer();
+		return;
+	}
+
 	for (int i = 0; i < 3 && !(Memory.FillRAM[0x2200] & 0x60); i++)
 	{
 	#ifdef DEBUGGER
 		if (SA1.Flags & TRACE_FLAG)
 			S9xSA1Trace();
+		if (GilgameshTracing)
+			GilgameshTraceSA1(Registers.PB, Registers.PCw);
 	#endif
 
 		register uint8				Op;
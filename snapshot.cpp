@@ -1718,6 +1718,8 @@ int S9xUnfreezeFromStream (STREAM stream)
 		S9xSetPCBase(Registers.PBPC);
 		S9xUnpackStatus();
 		S9xFixCycles();
+		CPU.NextCheck = 0;
+		Memory.map_Speed();
 
 		for (int d = 0; d < 8; d++)
 			DMA[d] = dma_snap.dma[d];
@@ -469,6 +469,8 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.DisableGameSpecificHacks       = !conf.GetBool("Hack::EnableGameSpecificHacks",       true);
 	Settings.BlockInvalidVRAMAccessMaster   = !conf.GetBool("Hack::AllowInvalidVRAMAccess",        false);
 	Settings.HDMATimingHack                 =  conf.GetInt ("Hack::HDMATiming",                    100);
+	Settings.SkipIdleLoops                  =  conf.GetBool("Hack::SpeedHacks",                    false);
+	Settings.SuperFXThread                  =  conf.GetBool("Hack::SuperFXThread",                 false);
 
 	// Netplay
 
@@ -495,6 +497,20 @@ void S9xLoadConfigFiles (char **argv, int argc)
 		ENSURE_TRACE_OPEN(trace,"trace.log","wb")
 		CPU.Flags |= TRACE_FLAG;
 	}
+
+	Settings.GilgameshTrace             =  conf.GetBool("DEBUG::GilgameshTrace",              true);
+	Settings.GilgameshFirstFrame        =  conf.GetUInt("DEBUG::GilgameshFirstFrame",         0);
+	Settings.GilgameshLastFrame         =  conf.GetUInt("DEBUG::GilgameshLastFrame",          0);
+	Settings.GilgameshSampling          =  conf.GetUInt("DEBUG::GilgameshSampling",           1);
+	if (!GilgameshParseRanges(conf.GetString("DEBUG::GilgameshRanges", "")))
+		fprintf(stderr, "Invalid DEBUG::GilgameshRanges\n");
+	Settings.GilgameshCheckpointFrames  =  conf.GetUInt("DEBUG::GilgameshCheckpointFrames",   0);
+	Settings.GilgameshCheckpointSeconds =  conf.GetUInt("DEBUG::GilgameshCheckpointSeconds",  60);
+	Settings.GilgameshMerge             =  conf.GetBool("DEBUG::GilgameshMerge",              false);
+	Settings.GilgameshExecLog           =  conf.GetBool("DEBUG::GilgameshExecLog",            false);
+	Settings.GilgameshColumns           =  conf.GetBool("DEBUG::GilgameshColumns",            false);
+	Settings.GilgameshReplayInterval    =  conf.GetUInt("DEBUG::GilgameshReplayInterval",     0);
+	Settings.GilgameshQuerySocket       =  conf.GetBool("DEBUG::GilgameshQuerySocket",        false);
 #endif
 
 	S9xParsePortConfig(conf, 1);
@@ -583,10 +599,28 @@ void S9xUsage (void)
 #ifdef DEBUGGER
 	S9xMessage(S9X_INFO, S9X_USAGE, "-debug                          Set the Debugger flag");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-trace                          Begin CPU instruction tracing");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-notracing                      Start with Gilgamesh tracing off (G in the debugger)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-traceframes <first> <last>     Only trace frames <first> to <last>");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-tracerange <range>             Only trace code in <range>, like $00:8000-$00:FFFF");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-tracesampling <num>            Only trace one instruction in <num>");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-checkpointframes <num>         Write the Gilgamesh database every <num> frames");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-checkpointseconds <num>        Write the Gilgamesh database every <num> seconds");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                (0 to disable, default 60)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-merge                          Add to the Gilgamesh database of the same ROM");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                instead of replacing it");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-execlog                        Log every CPU instruction to gilgamesh.exec");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-columns                        Also export the trace to gilgamesh.columns");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-replayinterval <num>           Record the input, and a snapshot every <num>");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                frames, for -replay");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-replay <first> <last>          Replay frames <first> to <last> of the session");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                recorded with -replayinterval, with -execlog");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-querysocket                    Answer queries about the trace on gilgamesh.sock");
 #endif
 	S9xMessage(S9X_INFO, S9X_USAGE, "-hdmatiming <1-199>             (Not recommended) Changes HDMA transfer timings");
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                event comes");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-invalidvramaccess              (Not recommended) Allow invalid VRAM access");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-speedhacks                     Skip idle loops up to the next event");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-superfxthread                  Run the Super FX on a thread of its own");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
 
 	// OTHER OPTIONS
@@ -844,6 +878,84 @@ char * S9xParseArgs (char **argv, int argc)
 				CPU.Flags |= TRACE_FLAG;
 			}
 			else
+			if (!strcasecmp(argv[i], "-notracing"))
+				Settings.GilgameshTrace = FALSE;
+			else
+			if (!strcasecmp(argv[i], "-traceframes"))
+			{
+				if (i + 2 < argc)
+				{
+					Settings.GilgameshFirstFrame = atoi(argv[++i]);
+					Settings.GilgameshLastFrame = atoi(argv[++i]);
+				}
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-tracerange"))
+			{
+				if (i + 1 >= argc || !GilgameshParseRanges(argv[++i]))
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-tracesampling"))
+			{
+				if (i + 1 < argc)
+					Settings.GilgameshSampling = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-checkpointframes"))
+			{
+				if (i + 1 < argc)
+					Settings.GilgameshCheckpointFrames = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-checkpointseconds"))
+			{
+				if (i + 1 < argc)
+					Settings.GilgameshCheckpointSeconds = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-merge"))
+				Settings.GilgameshMerge = TRUE;
+			else
+			if (!strcasecmp(argv[i], "-execlog"))
+				Settings.GilgameshExecLog = TRUE;
+			else
+			if (!strcasecmp(argv[i], "-columns"))
+				Settings.GilgameshColumns = TRUE;
+			else
+			if (!strcasecmp(argv[i], "-replayinterval"))
+			{
+				if (i + 1 < argc)
+					Settings.GilgameshReplayInterval = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-replay"))
+			{
+				if (i + 2 < argc)
+				{
+					Settings.GilgameshReplay = TRUE;
+					Settings.GilgameshReplayFirst = atoi(argv[++i]);
+					Settings.GilgameshReplayLast = atoi(argv[++i]);
+					if (Settings.GilgameshReplayFirst > Settings.GilgameshReplayLast)
+						S9xUsage();
+				}
+				else
+					S9xUsage();
+			}
+			else
+			if (!strcasecmp(argv[i], "-querysocket"))
+				Settings.GilgameshQuerySocket = TRUE;
+			else
 		#endif
 
 			if (!strcasecmp(argv[i], "-hdmatiming"))
@@ -861,6 +973,12 @@ char * S9xParseArgs (char **argv, int argc)
 			if (!strcasecmp(argv[i], "-invalidvramaccess"))
 				Settings.BlockInvalidVRAMAccessMaster = FALSE;
 			else
+			if (!strcasecmp(argv[i], "-speedhacks"))
+				Settings.SkipIdleLoops = TRUE;
+			else
+			if (!strcasecmp(argv[i], "-superfxthread"))
+				Settings.SuperFXThread = TRUE;
+			else
 
 			// OTHER OPTIONS
 
@@ -293,6 +293,7 @@ struct SCPUState
 	int32	CurrentDMAorHDMAChannel;
 	uint8	WhichEvent;
 	int32	NextEvent;
+	int32	NextCheck;		// see S9xUpdateCheckBudget()
 	bool8	WaitingForInterrupt;
 	uint32	AutoSaveTimer;
 	bool8	SRAMModified;
@@ -338,6 +339,20 @@ struct SSettings
 	bool8	TraceUnknownRegisters;
 	bool8	TraceDSP;
 	bool8	TraceHCEvent;
+	bool8	GilgameshTrace;
+	uint32	GilgameshFirstFrame;
+	uint32	GilgameshLastFrame;
+	uint32	GilgameshSampling;
+	uint32	GilgameshCheckpointFrames;
+	uint32	GilgameshCheckpointSeconds;
+	bool8	GilgameshMerge;
+	bool8	GilgameshExecLog;
+	bool8	GilgameshColumns;
+	uint32	GilgameshReplayInterval;
+	bool8	GilgameshReplay;
+	uint32	GilgameshReplayFirst;
+	uint32	GilgameshReplayLast;
+	bool8	GilgameshQuerySocket;
 
 	bool8	SuperFX;
 	uint8	DSP;
@@ -401,6 +416,8 @@ struct SSettings
 	bool8	BlockInvalidVRAMAccessMaster;
 	bool8	BlockInvalidVRAMAccess;
 	int32	HDMATimingHack;
+	bool8	SkipIdleLoops;
+	bool8	SuperFXThread;
 
 	bool8	ForcedPause;
 	bool8	Paused;
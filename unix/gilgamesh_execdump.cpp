@@ -0,0 +1,133 @@
+/* Prints the instructions of a Gilgamesh execution log as text.
+ *
+ * Usage: gilgamesh-execdump LOG [FIRST [LAST]]
+ *
+ * LOG is a gilgamesh.exec file, with its gilgamesh.exec.idx next to it.
+ * Only frames FIRST to LAST (inclusive, default: all of them) are decoded:
+ * the index gives the offset of the first one directly. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "gilgamesh_exec.h"
+
+struct SMapping
+{
+    const uint8_t* Data = NULL;
+    size_t Size = 0;
+
+    bool Open(const char* Path)
+    {
+        int File = open(Path, O_RDONLY);
+        struct stat Stat;
+        if (File < 0 || fstat(File, &Stat) < 0)
+        {
+            fprintf(stderr, "Cannot open %s\n", Path);
+            return false;
+        }
+
+        Size = Stat.st_size;
+        void* Mapping = Size ? mmap(NULL, Size, PROT_READ, MAP_PRIVATE, File, 0) : MAP_FAILED;
+        close(File);
+        if (Mapping == MAP_FAILED)
+        {
+            fprintf(stderr, "Cannot map %s\n", Path);
+            return false;
+        }
+
+        Data = (const uint8_t*) Mapping;
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        fprintf(stderr, "Usage: %s LOG [FIRST [LAST]]\n", argv[0]);
+        return 1;
+    }
+
+    SMapping Log, Index;
+    std::string IndexPath = std::string(argv[1]) + ".idx";
+    if (!Log.Open(argv[1]) || !Index.Open(IndexPath.c_str()))
+        return 1;
+
+    SExecLogHeader LogHeader = {};
+    SExecIndexHeader IndexHeader = {};
+    const uint8_t* Offsets = Index.Data + EXEC_INDEX_HEADER_SIZE;
+    if (Log.Size >= EXEC_LOG_HEADER_SIZE && Index.Size >= EXEC_INDEX_HEADER_SIZE)
+    {
+        ExecGetLogHeader(Log.Data, LogHeader);
+        ExecGetIndexHeader(Index.Data, IndexHeader);
+    }
+    if (memcmp(LogHeader.Magic, EXEC_LOG_MAGIC, 8) || LogHeader.Version != EXEC_LOG_VERSION ||
+        memcmp(IndexHeader.Magic, EXEC_INDEX_MAGIC, 8) || IndexHeader.Version != EXEC_LOG_VERSION)
+    {
+        fprintf(stderr, "%s: not an execution log of this version\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t Frames = (Index.Size - EXEC_INDEX_HEADER_SIZE) / sizeof(uint64_t);
+    uint32_t First = argc > 2 ? strtoul(argv[2], NULL, 0) : IndexHeader.FirstFrame;
+    uint32_t Last  = argc > 3 ? strtoul(argv[3], NULL, 0) : UINT32_MAX;
+    if (First < IndexHeader.FirstFrame || First - IndexHeader.FirstFrame >= Frames)
+    {
+        fprintf(stderr, "%s: only has frames %u to %u\n", argv[1], IndexHeader.FirstFrame,
+                IndexHeader.FirstFrame + Frames - 1);
+        return 1;
+    }
+
+    printf("; ROM CRC32 %08X\n", LogHeader.ROMCRC32);
+
+    std::vector<uint8_t> Raw;
+    uint64_t Offset;
+    ExecGetQuad(Offsets + (First - IndexHeader.FirstFrame) * sizeof(uint64_t), Offset);
+    while (Offset + EXEC_BLOCK_HEADER_SIZE <= Log.Size)
+    {
+        SExecBlockHeader Header;
+        const uint8_t* Data = ExecGetBlockHeader(Log.Data + Offset, Header);
+        uint32_t Size = Header.CompressedSize ? Header.CompressedSize : Header.RawSize;
+        if (Header.Frame > Last || Offset + EXEC_BLOCK_HEADER_SIZE + Size > Log.Size)
+            break;
+        Offset += EXEC_BLOCK_HEADER_SIZE + Size;
+
+        if (Header.CompressedSize)
+        {
+            uLongf RawSize = Header.RawSize;
+            Raw.resize(RawSize);
+            if (uncompress(Raw.data(), &RawSize, Data, Size) != Z_OK || RawSize != Header.RawSize)
+            {
+                fprintf(stderr, "%s: corrupt block of frame %u\n", argv[1], Header.Frame);
+                return 1;
+            }
+            Data = Raw.data();
+        }
+
+        SExecState State = {};
+        uint64_t Cycles = Header.Cycles;
+        const uint8_t* End = Data + Header.RawSize;
+        for (uint32_t i = 0; i < Header.Records; i++)
+        {
+            Data = ExecDecode(Data, End, State);
+            if (Data == NULL)
+            {
+                fprintf(stderr, "%s: corrupt block of frame %u\n", argv[1], Header.Frame);
+                return 1;
+            }
+            Cycles += State.Cycles;
+            printf("%u %llu %06X %02X A:%04X X:%04X Y:%04X S:%04X D:%04X DB:%02X P:%02X\n",
+                   Header.Frame, (unsigned long long) Cycles, State.PC, State.Opcode,
+                   State.A, State.X, State.Y, State.S, State.D, State.DB, State.P);
+        }
+    }
+
+    return 0;
+}
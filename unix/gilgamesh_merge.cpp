@@ -0,0 +1,307 @@
+/* Unions the traces of several gilgamesh.db files into one database.
+ *
+ * Usage: gilgamesh-merge OUTPUT INPUT...
+ *
+ * OUTPUT is created if it doesn't exist. Inputs are attached a few at a
+ * time and copied over with INSERT ... SELECT; only traces of the same ROM
+ * (by CRC32) as the output are merged. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+// SQLite allows 10 attached databases by default.
+static const int BATCH_SIZE = 8;
+
+static sqlite3* Database;
+
+// Tables of the coprocessors, with the same layout as the main CPU ones.
+static const char* const CoprocessorPrefixes[] = { "sa1_", "spc700_" };
+
+static bool SQLExec(const char* Statement)
+{
+    char* Error;
+
+    if (sqlite3_exec(Database, Statement, NULL, NULL, &Error) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", Error);
+        sqlite3_free(Error);
+        return false;
+    }
+
+    return true;
+}
+
+// ROM CRC32 of a trace, or -1 if it has none.
+static int64_t ROMCRC32(const char* Schema)
+{
+    char Query[64];
+    sqlite3_stmt* Statement;
+    int64_t CRC32 = -1;
+
+    snprintf(Query, sizeof(Query), "SELECT crc32 FROM %s.rom", Schema);
+    if (sqlite3_prepare_v2(Database, Query, -1, &Statement, NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step(Statement) == SQLITE_ROW)
+            CRC32 = sqlite3_column_int64(Statement, 0);
+        sqlite3_finalize(Statement);
+    }
+
+    return CRC32;
+}
+
+static bool CreateSchema(int64_t CRC32)
+{
+    char InsertROM[64];
+    snprintf(InsertROM, sizeof(InsertROM), "INSERT INTO rom VALUES(%lld)", (long long) CRC32);
+
+    return SQLExec("CREATE TABLE rom(crc32 INTEGER NOT NULL)") &&
+           SQLExec(InsertROM) &&
+           SQLExec("CREATE TABLE IF NOT EXISTS instructions(pc      INTEGER PRIMARY KEY,"
+                                                           "opcode  INTEGER NOT NULL,"
+                                                           "flags   INTEGER NOT NULL,"
+                                                           "operand INTEGER)") &&
+           SQLExec("CREATE TABLE IF NOT EXISTS references_(pointer INTEGER,"
+                                                          "pointee INTEGER,"
+                                                          "type    INTEGER)") &&
+           SQLExec("CREATE TABLE IF NOT EXISTS dma(pc          INTEGER,"
+                                                  "source      INTEGER,"
+                                                  "destination INTEGER,"
+                                                  "bytes       INTEGER)") &&
+           SQLExec("CREATE TABLE IF NOT EXISTS vectors(pc   INTEGER PRIMARY KEY,"
+                                                      "type INTEGER NOT NULL)") &&
+           SQLExec("CREATE UNIQUE INDEX IF NOT EXISTS references_key ON references_(pointer, pointee, type)") &&
+           SQLExec("CREATE UNIQUE INDEX IF NOT EXISTS dma_key ON dma(pc, source, destination, bytes)");
+}
+
+static bool HasTable(const char* Schema, const char* Table)
+{
+    char Query[128];
+    sqlite3_stmt* Statement;
+    bool Found = false;
+
+    snprintf(Query, sizeof(Query), "SELECT 1 FROM %s.sqlite_master WHERE type = 'table' AND name = ?", Schema);
+    if (sqlite3_prepare_v2(Database, Query, -1, &Statement, NULL) == SQLITE_OK)
+    {
+        sqlite3_bind_text(Statement, 1, Table, -1, SQLITE_STATIC);
+        Found = sqlite3_step(Statement) == SQLITE_ROW;
+        sqlite3_finalize(Statement);
+    }
+
+    return Found;
+}
+
+static bool MergeSchema(const char* Schema)
+{
+    char Statement[512];
+
+    static const char* const Merges[] =
+    {
+        "INSERT OR REPLACE INTO instructions SELECT pc, opcode, flags, operand FROM %s.instructions",
+        "INSERT OR IGNORE INTO references_ SELECT pointer, pointee, type FROM %s.references_",
+        "INSERT OR IGNORE INTO dma SELECT pc, source, destination, bytes FROM %s.dma",
+        "INSERT OR REPLACE INTO vectors SELECT pc, type FROM %s.vectors",
+    };
+
+    for (const char* Merge: Merges)
+    {
+        snprintf(Statement, sizeof(Statement), Merge, Schema);
+        if (!SQLExec(Statement))
+            return false;
+    }
+
+    // Profiles add up. ("WHERE true" disambiguates the upsert clause.)
+    if (HasTable(Schema, "profile"))
+    {
+        snprintf(Statement, sizeof(Statement),
+                 "INSERT INTO profile SELECT pc, executions, cycles FROM %s.profile WHERE true "
+                 "ON CONFLICT(pc) DO UPDATE SET executions = executions + excluded.executions, "
+                 "cycles = cycles + excluded.cycles", Schema);
+        if (!SQLExec(Statement))
+            return false;
+    }
+    if (HasTable(Schema, "calls"))
+    {
+        snprintf(Statement, sizeof(Statement),
+                 "INSERT INTO calls SELECT caller, callee, calls, inclusive, exclusive FROM %s.calls WHERE true "
+                 "ON CONFLICT(caller, callee) DO UPDATE SET calls = calls + excluded.calls, "
+                 "inclusive = inclusive + excluded.inclusive, exclusive = exclusive + excluded.exclusive", Schema);
+        if (!SQLExec(Statement))
+            return false;
+    }
+    // Keeps the first reader seen, and the writer of the last input.
+    if (HasTable(Schema, "memory"))
+    {
+        snprintf(Statement, sizeof(Statement),
+                 "INSERT INTO memory SELECT space, address, writer, reader, access FROM %s.memory WHERE true "
+                 "ON CONFLICT(space, address) DO UPDATE SET writer = COALESCE(excluded.writer, writer), "
+                 "reader = COALESCE(reader, excluded.reader), access = access | excluded.access", Schema);
+        if (!SQLExec(Statement))
+            return false;
+    }
+
+    for (const char* Prefix: CoprocessorPrefixes)
+    {
+        static const char* const CoprocessorMerges[][2] =
+        {
+            {"instructions", "INSERT OR REPLACE INTO %sinstructions SELECT pc, opcode, flags, operand FROM %s.%sinstructions"},
+            {"references_",  "INSERT OR IGNORE INTO %sreferences_ SELECT pointer, pointee, type FROM %s.%sreferences_"},
+            {"vectors",      "INSERT OR REPLACE INTO %svectors SELECT pc, type FROM %s.%svectors"},
+        };
+
+        for (auto& Merge: CoprocessorMerges)
+        {
+            char Table[32];
+            snprintf(Table, sizeof(Table), "%s%s", Prefix, Merge[0]);
+            if (!HasTable("main", Table) || !HasTable(Schema, Table))
+                continue;
+            snprintf(Statement, sizeof(Statement), Merge[1], Prefix, Schema, Prefix);
+            if (!SQLExec(Statement))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// The output may predate the coprocessor tables.
+static bool CreateCoprocessorSchema()
+{
+    char Statement[256];
+
+    for (const char* Prefix: CoprocessorPrefixes)
+    {
+        const char* const Creates[] =
+        {
+            "CREATE TABLE IF NOT EXISTS %sinstructions(pc INTEGER PRIMARY KEY, opcode INTEGER NOT NULL, "
+                                                      "flags INTEGER NOT NULL, operand INTEGER)",
+            "CREATE TABLE IF NOT EXISTS %sreferences_(pointer INTEGER, pointee INTEGER, type INTEGER)",
+            "CREATE UNIQUE INDEX IF NOT EXISTS %sreferences_key ON %sreferences_(pointer, pointee, type)",
+        };
+
+        for (const char* Create: Creates)
+        {
+            snprintf(Statement, sizeof(Statement), Create, Prefix, Prefix);
+            if (!SQLExec(Statement))
+                return false;
+        }
+    }
+
+    // The SPC700 has no vectors worth tracing: it only ever resets.
+    return SQLExec("CREATE TABLE IF NOT EXISTS sa1_vectors(pc   INTEGER PRIMARY KEY,"
+                                                          "type INTEGER NOT NULL)");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s OUTPUT INPUT...\n", argv[0]);
+        return 1;
+    }
+
+    if (sqlite3_open(argv[1], &Database) != SQLITE_OK)
+    {
+        fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(Database));
+        return 1;
+    }
+
+    if (!SQLExec("PRAGMA journal_mode = WAL") ||
+        !SQLExec("PRAGMA synchronous = NORMAL") ||
+        !SQLExec("PRAGMA cache_size = -65536") ||
+        !SQLExec("PRAGMA temp_store = MEMORY") ||
+        !SQLExec("CREATE TABLE IF NOT EXISTS profile(pc         INTEGER PRIMARY KEY,"
+                                                    "executions INTEGER NOT NULL,"
+                                                    "cycles     INTEGER NOT NULL)") ||
+        !SQLExec("CREATE TABLE IF NOT EXISTS calls(caller    INTEGER NOT NULL,"
+                                                  "callee    INTEGER NOT NULL,"
+                                                  "calls     INTEGER NOT NULL,"
+                                                  "inclusive INTEGER NOT NULL,"
+                                                  "exclusive INTEGER NOT NULL,"
+                                                  "PRIMARY KEY (caller, callee))") ||
+        !SQLExec("CREATE TABLE IF NOT EXISTS memory(space   INTEGER NOT NULL,"
+                                                   "address INTEGER NOT NULL,"
+                                                   "writer  INTEGER,"
+                                                   "reader  INTEGER,"
+                                                   "access  INTEGER NOT NULL,"
+                                                   "PRIMARY KEY (space, address))") ||
+        !CreateCoprocessorSchema())
+        return 1;
+
+    int64_t CRC32 = ROMCRC32("main");
+    int Merged = 0;
+
+    for (int First = 2; First < argc; First += BATCH_SIZE)
+    {
+        int Last = First + BATCH_SIZE < argc ? First + BATCH_SIZE : argc;
+        bool Attached[BATCH_SIZE] = {};
+        char Schema[16];
+
+        // ATTACH isn't allowed inside a transaction.
+        for (int i = First; i < Last; i++)
+        {
+            sqlite3_stmt* Attach;
+            snprintf(Schema, sizeof(Schema), "input%d", i - First);
+
+            sqlite3_prepare_v2(Database, "ATTACH DATABASE ? AS ?", -1, &Attach, NULL);
+            sqlite3_bind_text(Attach, 1, argv[i], -1, SQLITE_STATIC);
+            sqlite3_bind_text(Attach, 2, Schema, -1, SQLITE_STATIC);
+            if (sqlite3_step(Attach) == SQLITE_DONE)
+                Attached[i - First] = true;
+            else
+                fprintf(stderr, "%s: %s, skipping\n", argv[i], sqlite3_errmsg(Database));
+            sqlite3_finalize(Attach);
+        }
+
+        if (!SQLExec("BEGIN TRANSACTION"))
+            return 1;
+
+        for (int i = First; i < Last; i++)
+        {
+            if (!Attached[i - First])
+                continue;
+            snprintf(Schema, sizeof(Schema), "input%d", i - First);
+
+            int64_t InputCRC32 = ROMCRC32(Schema);
+            if (InputCRC32 == -1)
+            {
+                fprintf(stderr, "%s: no ROM CRC32, skipping\n", argv[i]);
+                continue;
+            }
+
+            if (CRC32 == -1)
+            {
+                if (!CreateSchema(InputCRC32))
+                    return 1;
+                CRC32 = InputCRC32;
+            }
+            else if (InputCRC32 != CRC32)
+            {
+                fprintf(stderr, "%s: different ROM (CRC32 %08llX), skipping\n", argv[i], (long long) InputCRC32);
+                continue;
+            }
+
+            if (!MergeSchema(Schema))
+                return 1;
+            Merged++;
+        }
+
+        if (!SQLExec("COMMIT TRANSACTION"))
+            return 1;
+
+        for (int i = First; i < Last; i++)
+        {
+            char Detach[32];
+            if (!Attached[i - First])
+                continue;
+            snprintf(Detach, sizeof(Detach), "DETACH DATABASE input%d", i - First);
+            SQLExec(Detach);
+        }
+    }
+
+    SQLExec("PRAGMA wal_checkpoint(TRUNCATE)");
+    sqlite3_close(Database);
+
+    printf("Merged %d of %d databases.\n", Merged, argc - 2);
+    return 0;
+}
@@ -1767,6 +1767,11 @@ int main (int argc, char **argv)
 		CPU.Flags |= flags;
 	}
 
+#ifdef DEBUGGER
+	if (!GilgameshStartSession())
+		exit(1);
+#endif
+
 	S9xGraphicsMode();
 
 	sprintf(String, "\"%s\" %s: %s", Memory.ROMName, TITLE, VERSION);